@@ -0,0 +1,192 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "accesslog.h"
+#include "spsc.h"
+#include "status.h"
+
+struct AccessLogStats access_log_stats;
+
+static int fd = -1;
+static struct Spsc queue;
+static pthread_t thread;
+static pthread_mutex_t wake_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake_cond = PTHREAD_COND_INITIALIZER;
+static int pending = 0;
+static volatile int running = 0;
+static uint32_t next_seq = 0;
+static void (*sink)(const void * data, int len) = NULL;
+
+uint32_t accessLogCheck(const struct AccessRecord * r) {
+	// FNV-1a over the bytes before 'check'
+	const unsigned char * p = (const unsigned char *) r;
+	uint32_t h = 2166136261u;
+	for (size_t i = 0; i < offsetof(struct AccessRecord, check); i++) {
+		h ^= p[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static int writeAll(const void * buf, size_t len) {
+	const char * p = (const char *) buf;
+	while (len > 0) {
+		ssize_t n = write(fd, p, len);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			return -1;
+		}
+		p += n;
+		len -= n;
+	}
+	return 0;
+}
+
+// Everything that is queued goes out with one write() and one fdatasync()
+static void commit() {
+	struct AccessRecord batch[ACCESS_LOG_QUEUE];
+	int cnt = 0;
+	while (cnt < ACCESS_LOG_QUEUE && spscPop(&queue, &batch[cnt])) cnt++;
+	if (cnt == 0) return;
+
+	long start = monotonicUs();
+	if (writeAll(batch, sizeof(struct AccessRecord) * cnt) != 0 || fdatasync(fd) != 0) {
+		perror("access log");
+	}
+	if (sink) sink(batch, sizeof(struct AccessRecord) * cnt);
+	long t = monotonicUs() - start;
+
+	access_log_stats.records += cnt;
+	access_log_stats.commits++;
+	if (cnt > access_log_stats.max_batch) access_log_stats.max_batch = cnt;
+	access_log_stats.last_commit_us = t;
+	if (t > access_log_stats.max_commit_us) access_log_stats.max_commit_us = t;
+}
+
+static void * writer(void * arg) {
+	pthread_mutex_lock(&wake_lock);
+	while (1) {
+		while (!pending && running) pthread_cond_wait(&wake_cond, &wake_lock);
+		if (!pending && !running) break;
+
+		// Group commit: records of the next ACCESS_LOG_COMMIT_MS join this one
+		if (running) {
+			struct timespec ts;
+			clock_gettime(CLOCK_REALTIME, &ts);
+			ts.tv_nsec += ACCESS_LOG_COMMIT_MS * 1000000L;
+			if (ts.tv_nsec >= 1000000000L) {
+				ts.tv_sec++;
+				ts.tv_nsec -= 1000000000L;
+			}
+			while (running && pthread_cond_timedwait(&wake_cond, &wake_lock, &ts) != ETIMEDOUT);
+		}
+		pending = 0;
+		pthread_mutex_unlock(&wake_lock);
+		commit();
+		pthread_mutex_lock(&wake_lock);
+	}
+	pthread_mutex_unlock(&wake_lock);
+	commit();
+	return NULL;
+}
+
+int accessLogInit(const char * path, void (*sinkFn)(const void * data, int len)) {
+	sink = sinkFn;
+	fd = open(path, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		perror(path);
+		return -1;
+	}
+
+	// A log of another format isn't appended to: it is moved aside and a new one started
+	long head = sizeof(struct AccessLogHeader), size = sizeof(struct AccessRecord);
+	struct AccessLogHeader old;
+	if (pread(fd, &old, sizeof(old), 0) == head && (old.magic != ACCESS_LOG_MAGIC
+			|| old.version != ACCESS_LOG_VERSION || old.record_size != size)) {
+		char aside[512];
+		snprintf(aside, sizeof(aside), "%s.%ld.old", path, (long) time(NULL));
+		fprintf(stderr, "%s: not a version %i log, moved to %s\n", path, ACCESS_LOG_VERSION, aside);
+		close(fd);
+		if (rename(path, aside) != 0) perror(aside);
+		fd = open(path, O_RDWR | O_APPEND | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (fd < 0) {
+			perror(path);
+			return -1;
+		}
+	}
+
+	// A new file starts with the header. A torn tail is cut off: a partial record, so the
+	// records stay aligned, and then whole records whose check fails. The numbering goes on
+	// from the last record that is left.
+	next_seq = 0;
+	struct stat st;
+	if (fstat(fd, &st) == 0) {
+		if (st.st_size < head) {
+			struct AccessLogHeader h = { ACCESS_LOG_MAGIC, ACCESS_LOG_VERSION, sizeof(struct AccessRecord), 0 };
+			if (ftruncate(fd, 0) != 0 || writeAll(&h, sizeof(h)) != 0) perror(path);
+		} else {
+			long end = st.st_size - (st.st_size - head) % size;
+			struct AccessRecord r;
+			while (end > head && (pread(fd, &r, size, end - size) != size || r.check != accessLogCheck(&r))) {
+				end -= size;
+			}
+			if (end > head) next_seq = r.seq + 1;
+			if (end != st.st_size) {
+				fprintf(stderr, "%s: cutting off %ld broken bytes at the end\n", path, (long) st.st_size - end);
+				if (ftruncate(fd, end) != 0) perror(path);
+			}
+		}
+	}
+
+	spscInit(&queue, ACCESS_LOG_QUEUE, sizeof(struct AccessRecord));
+	running = 1;
+	if (pthread_create(&thread, NULL, writer, NULL) != 0) {
+		perror("pthread_create");
+		running = 0;
+		close(fd);
+		fd = -1;
+		return -1;
+	}
+	return 0;
+}
+
+int accessLog(int64_t t_us, int gui_id, int comp, int outcome, int photo) {
+	struct AccessRecord r;
+	memset(&r, 0, sizeof(r));
+	r.t_us = t_us;
+	r.seq = next_seq++;
+	r.gui_id = gui_id;
+	r.comp = comp;
+	r.outcome = outcome;
+	r.photo = photo;
+	r.check = accessLogCheck(&r);
+	if (!running || !spscPush(&queue, &r)) {
+		access_log_stats.dropped++;
+		return -1;
+	}
+
+	pthread_mutex_lock(&wake_lock);
+	pending = 1;
+	pthread_cond_signal(&wake_cond);
+	pthread_mutex_unlock(&wake_lock);
+	return 0;
+}
+
+void accessLogClose() {
+	if (!running) return;
+	pthread_mutex_lock(&wake_lock);
+	running = 0;
+	pthread_cond_signal(&wake_cond);
+	pthread_mutex_unlock(&wake_lock);
+	pthread_join(thread, NULL);
+	close(fd);
+	fd = -1;
+	spscFree(&queue);
+}
@@ -0,0 +1,60 @@
+#ifndef ACCESSLOG_H
+#define ACCESSLOG_H
+
+#include <stdint.h>
+
+#define ACCESS_LOG_FILE "../logs/access.log"
+#define ACCESS_LOG_QUEUE 256
+// A commit waits this long for more records, so a burst is written with one fsync
+#define ACCESS_LOG_COMMIT_MS 50
+
+#define ACCESS_LOG_MAGIC 0x4c41434c // "LCAL"
+#define ACCESS_LOG_VERSION 1
+
+#define ACCESS_DENIED 0
+#define ACCESS_GRANTED 1	// the return time was chosen and the box opened
+#define ACCESS_RESERVED 2	// right PIN, but the computer is reserved now
+#define ACCESS_CANCELLED 3	// right PIN, the return time picker was left without taking it
+
+/*
+	The file is a header and then records, both fixed size and little endian as the Pi writes
+	them. A record whose 'check' doesn't match was torn by a power cut: accessLogInit() cuts
+	those off the end, readers skip any others.
+*/
+struct AccessLogHeader {
+	uint32_t magic, version, record_size, reserved;
+};
+
+struct AccessRecord {
+	int64_t t_us;		// unix time in microseconds
+	uint32_t seq;		// number of the record in the log, goes on across restarts
+	int32_t gui_id;		// icon number
+	int32_t comp;		// physical computer id, -1 if none
+	int32_t outcome;	// ACCESS_*
+	int32_t photo;		// attempt number of the photo (see cameraPhotoPath()), -1 if none
+	uint32_t check;		// accessLogCheck() of the fields above
+};
+
+struct AccessLogStats {
+	long records, commits, dropped, max_batch;
+	long last_commit_us, max_commit_us;
+};
+
+extern struct AccessLogStats access_log_stats;
+
+// Opens (creates) the log and starts the writer thread. A log of another format is renamed
+// to <path>.<unix time>.old and a new one started.
+// 'sink' gets every batch of records once it is written, NULL if they go nowhere else.
+int accessLogInit(const char * path, void (*sink)(const void * data, int len));
+
+// Never blocks: the record is queued and written by the writer thread.
+// Returns -1 if the queue is full and the record is dropped.
+// Only one thread may call it (the UI).
+int accessLog(int64_t t_us, int gui_id, int comp, int outcome, int photo);
+
+// Writes what is queued and stops the thread
+void accessLogClose();
+
+uint32_t accessLogCheck(const struct AccessRecord * r);
+
+#endif
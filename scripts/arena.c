@@ -0,0 +1,44 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+
+struct ArenaChunk {
+	struct ArenaChunk * next;
+	size_t used, cap;
+	char data[];
+};
+
+void * arenaAlloc(struct Arena * arena, size_t size) {
+	size = (size + 15) & ~(size_t) 15;
+	struct ArenaChunk * c = arena->chunks;
+	if (c == NULL || c->cap - c->used < size) {
+		size_t cap = size > ARENA_CHUNK ? size : ARENA_CHUNK;
+		c = (struct ArenaChunk *) malloc(sizeof(struct ArenaChunk) + cap);
+		if (c == NULL) return NULL;
+		c->used = 0;
+		c->cap = cap;
+		c->next = arena->chunks;
+		arena->chunks = c;
+		arena->cnt_mallocs++;
+	}
+	void * p = c->data + c->used;
+	c->used += size;
+	arena->cnt_allocs++;
+	arena->bytes += size;
+	return p;
+}
+
+void * arenaGrow(struct Arena * arena, void * old, size_t old_size, size_t new_size) {
+	void * p = arenaAlloc(arena, new_size);
+	if (p != NULL && old != NULL) memcpy(p, old, old_size < new_size ? old_size : new_size);
+	return p;
+}
+
+void arenaFree(struct Arena * arena) {
+	while (arena->chunks) {
+		struct ArenaChunk * next = arena->chunks->next;
+		free(arena->chunks);
+		arena->chunks = next;
+	}
+}
@@ -0,0 +1,23 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+#define ARENA_CHUNK 16384
+
+struct ArenaChunk;
+
+// Bump allocator. Memory is never freed separately, only the whole arena at once.
+struct Arena {
+	struct ArenaChunk * chunks;
+	long cnt_allocs;	// arenaAlloc() calls
+	long cnt_mallocs;	// chunks taken from malloc
+	long bytes;			// bytes handed out
+};
+
+void * arenaAlloc(struct Arena * arena, size_t size);
+// Like realloc, but the old block stays in the arena
+void * arenaGrow(struct Arena * arena, void * old, size_t old_size, size_t new_size);
+void arenaFree(struct Arena * arena);
+
+#endif
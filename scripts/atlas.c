@@ -0,0 +1,22 @@
+#include "render.h"
+
+void atlasInit(struct AtlasPacker * p, int width, int height) {
+	p->width = width;
+	p->height = height;
+	p->x = p->y = p->row_h = 0;
+}
+
+int atlasPack(struct AtlasPacker * p, int w, int h, int * x, int * y) {
+	if (w > p->width) return 0;
+	if (p->x + w > p->width) {
+		p->y += p->row_h;
+		p->x = 0;
+		p->row_h = 0;
+	}
+	if (p->y + h > p->height) return 0;
+	*x = p->x;
+	*y = p->y;
+	p->x += w;
+	if (h > p->row_h) p->row_h = h;
+	return 1;
+}
@@ -0,0 +1,77 @@
+#include <stdio.h>
+
+#include "calib.h"
+
+// x = 800 - (rx / 40.96 - 40) * 1.1111, y = (ry / 63.015 - 45) * 1.1733
+const struct Calibration calib_default = {
+	-1778, 0, 55341511,
+	0, 1220, -3460301
+};
+
+void calibApply(const struct Calibration * cal, int rx, int ry, int * x, int * y) {
+	// Products of 15 bit readings and the coefficients don't fit in 32 bits for every map
+	long long half = 1 << (CALIB_SHIFT - 1);
+	*x = (int) (((long long) cal->a * rx + (long long) cal->b * ry + cal->c + half) >> CALIB_SHIFT);
+	*y = (int) (((long long) cal->d * rx + (long long) cal->e * ry + cal->f + half) >> CALIB_SHIFT);
+}
+
+static int fixed(double v) {
+	double s = v * (1 << CALIB_SHIFT);
+	return (int) (s < 0 ? s - 0.5 : s + 0.5);
+}
+
+int calibSolve(const int raw[3][2], const int screen[3][2], struct Calibration * cal) {
+	// Cramer's rule for [rx ry 1] * (a b c) = x and the same for y
+	double x0 = raw[0][0], y0 = raw[0][1];
+	double x1 = raw[1][0], y1 = raw[1][1];
+	double x2 = raw[2][0], y2 = raw[2][1];
+	double det = x0 * (y1 - y2) - y0 * (x1 - x2) + (x1 * y2 - x2 * y1);
+	if (det > -1.0 && det < 1.0) return -1;
+
+	double coef[2][3];
+	for (int k = 0; k < 2; k++) {
+		double s0 = screen[0][k], s1 = screen[1][k], s2 = screen[2][k];
+		coef[k][0] = (s0 * (y1 - y2) - y0 * (s1 - s2) + (s1 * y2 - s2 * y1)) / det;
+		coef[k][1] = (x0 * (s1 - s2) - s0 * (x1 - x2) + (x1 * s2 - x2 * s1)) / det;
+		coef[k][2] = (x0 * (y1 * s2 - y2 * s1) - y0 * (x1 * s2 - x2 * s1) + s0 * (x1 * y2 - x2 * y1)) / det;
+	}
+	cal->a = fixed(coef[0][0]);
+	cal->b = fixed(coef[0][1]);
+	cal->c = fixed(coef[0][2]);
+	cal->d = fixed(coef[1][0]);
+	cal->e = fixed(coef[1][1]);
+	cal->f = fixed(coef[1][2]);
+	return 0;
+}
+
+int calibLoad(const char * path, struct Calibration * cal) {
+	FILE * f = fopen(path, "r");
+	if (f == NULL) return -1;
+	char line[256];
+	int res = -1;
+	while (fgets(line, sizeof(line), f)) {
+		if (line[0] == '#') continue;
+		struct Calibration c;
+		if (sscanf(line, "%d %d %d %d %d %d", &c.a, &c.b, &c.c, &c.d, &c.e, &c.f) == 6) {
+			*cal = c;
+			res = 0;
+			break;
+		}
+	}
+	fclose(f);
+	return res;
+}
+
+int calibSave(const char * path, const struct Calibration * cal) {
+	FILE * f = fopen(path, "w");
+	if (f == NULL) {
+		perror(path);
+		return -1;
+	}
+	fprintf(f, "# Touch calibration, written by the calibration scene (CALIBRATE=1)\n");
+	fprintf(f, "# a b c d e f: x = (a * rx + b * ry + c) >> %i, y = (d * rx + e * ry + f) >> %i\n",
+		CALIB_SHIFT, CALIB_SHIFT);
+	fprintf(f, "%d %d %d %d %d %d\n", cal->a, cal->b, cal->c, cal->d, cal->e, cal->f);
+	fclose(f);
+	return 0;
+}
@@ -0,0 +1,29 @@
+#ifndef CALIB_H
+#define CALIB_H
+
+#define CALIB_FILE "calib.txt"
+#define CALIB_SHIFT 16
+
+/*
+	Affine map from raw XPT2046 readings (15 bit) to screen pixels in fixed point:
+		x = (a * rx + b * ry + c) >> CALIB_SHIFT
+		y = (d * rx + e * ry + f) >> CALIB_SHIFT
+*/
+struct Calibration {
+	int a, b, c, d, e, f;
+};
+
+// What the old float multipliers of getValueX()/getValueY() did
+extern const struct Calibration calib_default;
+
+void calibApply(const struct Calibration * cal, int rx, int ry, int * x, int * y);
+
+// Solves the map from 3 touches: raw[i] = {rx, ry} was read at screen[i] = {x, y}.
+// Returns -1 if the points are on one line.
+int calibSolve(const int raw[3][2], const int screen[3][2], struct Calibration * cal);
+
+// Returns -1 if the file is missing or broken, 'cal' is left as it is then
+int calibLoad(const char * path, struct Calibration * cal);
+int calibSave(const char * path, const struct Calibration * cal);
+
+#endif
@@ -0,0 +1,112 @@
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "camera.h"
+#include "spsc.h"
+#include "status.h"
+
+struct CameraStats camera_stats;
+
+static struct CameraBackend * camera = NULL;
+static struct Spsc jobs;
+static sem_t wake;
+static pthread_t thread;
+
+void cameraPhotoPath(const struct CameraJob * job, const char * ext, char * path, int len) {
+	struct tm tm;
+	char date[32];
+	localtime_r(&job->t, &tm);
+	strftime(date, sizeof(date), "%Y-%m-%d_%H%M%S", &tm);
+	snprintf(path, len, "%s/%s_%i.%s", CAMERA_DIR, date, job->attempt, ext);
+}
+
+static int raspistillCapture(const struct CameraJob * job, const char * path) {
+	pid_t pid = fork();
+	if (pid < 0) return -1;
+	if (pid == 0) {
+		execlp("raspistill", "raspistill", "-rot", "270", "-o", path, (char *) NULL);
+		_exit(127);
+	}
+	int st;
+	if (waitpid(pid, &st, 0) < 0) return -1;
+	return WIFEXITED(st) && WEXITSTATUS(st) == 0 ? 0 : -1;
+}
+
+static int fileCapture(const struct CameraJob * job, const char * path) {
+	FILE * f = fopen(path, "w");
+	if (f == NULL) return -1;
+	fprintf(f, "attempt %i, computer %i, time %li\n", job->attempt, job->comp, (long) job->t);
+	fclose(f);
+	return 0;
+}
+
+struct CameraBackend camera_raspistill = { "raspistill", "jpg", raspistillCapture };
+struct CameraBackend camera_file = { "file", "txt", fileCapture };
+
+static void * captureLoop(void * arg) {
+	struct CameraJob job;
+	char path[256];
+	while (1) {
+		sem_wait(&wake);
+		if (!spscPop(&jobs, &job)) continue;
+		if (job.stop) break;
+
+		cameraPhotoPath(&job, camera->ext, path, sizeof(path));
+		long start = monotonicUs();
+		int res = camera->capture(&job, path);
+		long t = monotonicUs() - start;
+
+		camera_stats.last_us = t;
+		if (t > camera_stats.max_us) camera_stats.max_us = t;
+		if (res == 0) {
+			camera_stats.captured++;
+		} else {
+			camera_stats.failed++;
+			fprintf(stderr, "%s: failed to capture %s\n", camera->name, path);
+		}
+	}
+	return NULL;
+}
+
+int cameraInit(struct CameraBackend * backend) {
+	camera = backend;
+	spscInit(&jobs, CAMERA_QUEUE, sizeof(struct CameraJob));
+	sem_init(&wake, 0, 0);
+	if (pthread_create(&thread, NULL, captureLoop, NULL) != 0) {
+		perror("pthread_create");
+		camera = NULL;
+		return -1;
+	}
+	return 0;
+}
+
+int cameraPost(int attempt, int comp, time_t t) {
+	struct CameraJob job;
+	job.attempt = attempt;
+	job.comp = comp;
+	job.t = t;
+	job.stop = 0;
+	if (camera == NULL || !spscPush(&jobs, &job)) {
+		camera_stats.dropped++;
+		return -1;
+	}
+	sem_post(&wake);
+	return 0;
+}
+
+void cameraClose() {
+	if (camera == NULL) return;
+	struct CameraJob job;
+	memset(&job, 0, sizeof(job));
+	job.stop = 1;
+	while (!spscPush(&jobs, &job)) {
+		usleep(1000);
+	}
+	sem_post(&wake);
+	pthread_join(thread, NULL);
+	camera = NULL;
+}
@@ -0,0 +1,47 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <time.h>
+
+#define CAMERA_DIR "../logs"
+#define CAMERA_QUEUE 8
+
+// "attempt N happened at tick T"
+struct CameraJob {
+	int attempt;
+	int comp;
+	time_t t;
+	int stop;
+};
+
+struct CameraBackend {
+	const char * name;
+	const char * ext;	// of the files it writes, see cameraPhotoPath()
+	// Takes a photo into 'path'. Runs on the capture thread, may block. 0 on success.
+	int (*capture)(const struct CameraJob * job, const char * path);
+};
+
+extern struct CameraBackend camera_raspistill; // real camera
+extern struct CameraBackend camera_file; // writes a text file instead of a photo, for testing without the camera
+
+struct CameraStats {
+	int captured, failed, dropped;
+	long last_us, max_us;
+};
+
+extern struct CameraStats camera_stats;
+
+// Starts the capture thread
+int cameraInit(struct CameraBackend * backend);
+
+// Never blocks, the job is dropped if the queue is full. Returns -1 in that case.
+// 't' is the time of the attempt, it names the photo.
+int cameraPost(int attempt, int comp, time_t t);
+
+// Path of the photo of a job: "<CAMERA_DIR>/<date>_<attempt>.<ext>"
+void cameraPhotoPath(const struct CameraJob * job, const char * ext, char * path, int len);
+
+// Waits for the queued jobs
+void cameraClose();
+
+#endif
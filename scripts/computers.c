@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "computers.h"
+#include "intmap.h"
+
+struct Computer * computers = NULL;
+int cnt_computers = 0;
+int computers_version = 0;
+
+static char computers_path[256] = COMPUTERS_FILE;
+static struct timespec computers_mtime;
+static struct IntMap by_gui, by_id;
+
+int computersLoad(const char * path) {
+	FILE * f = fopen(path, "r");
+	if (f == NULL) return -1;
+
+	struct stat st;
+	if (fstat(fileno(f), &st) == 0) computers_mtime = st.st_mtim;
+	if (path != computers_path) {
+		strncpy(computers_path, path, sizeof(computers_path) - 1);
+	}
+
+	int cap = 64, cnt = 0;
+	struct Computer * table = (struct Computer *) malloc(sizeof(struct Computer) * cap);
+	char line[256];
+	while (fgets(line, sizeof(line), f)) {
+		struct Computer c;
+		if (sscanf(line, "%d %d %d", &c.id, &c.gui_id, &c.group) != 3) continue;
+		if (cnt == cap) {
+			cap *= 2;
+			table = (struct Computer *) realloc(table, sizeof(struct Computer) * cap);
+		}
+		table[cnt++] = c;
+	}
+	fclose(f);
+
+	if (computers == NULL) {
+		intMapInit(&by_gui, cnt);
+		intMapInit(&by_id, cnt);
+	} else {
+		intMapClear(&by_gui);
+		intMapClear(&by_id);
+	}
+	// The first line wins, like it did in check.py
+	for (int i = cnt - 1; i >= 0; i--) {
+		intMapPut(&by_gui, table[i].gui_id, i);
+		intMapPut(&by_id, table[i].id, i);
+	}
+
+	free(computers);
+	computers = table;
+	cnt_computers = cnt;
+	computers_version++;
+	return cnt;
+}
+
+int computersRefresh() {
+	struct stat st;
+	if (stat(computers_path, &st) != 0) return 0;
+	if (computers != NULL && st.st_mtim.tv_sec == computers_mtime.tv_sec
+		&& st.st_mtim.tv_nsec == computers_mtime.tv_nsec) return 0;
+	return computersLoad(computers_path) >= 0;
+}
+
+struct Computer * computerByGui(int gui_id) {
+	int i = intMapGet(&by_gui, gui_id, -1);
+	if (i < 0) return NULL;
+	return &computers[i];
+}
+
+struct Computer * computerById(int id) {
+	int i = intMapGet(&by_id, id, -1);
+	if (i < 0) return NULL;
+	return &computers[i];
+}
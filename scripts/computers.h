@@ -0,0 +1,33 @@
+#ifndef COMPUTERS_H
+#define COMPUTERS_H
+
+#define COMPUTERS_FILE "computers.txt"
+
+/*
+	One line of computers.txt: "<id> <gui id> <group>"
+
+id     - physical computer id (used in pincodes.txt)
+gui_id - number of the icon on the screen
+group  - lock that has to be opened to get the computer
+*/
+struct Computer {
+	int id, gui_id, group;
+};
+
+extern struct Computer * computers;
+extern int cnt_computers;
+// Incremented every time the table is (re)loaded
+extern int computers_version;
+
+// Returns number of loaded computers or -1 if the file can't be read.
+// On error the previous table is kept.
+int computersLoad(const char * path);
+
+// Reloads the table if the file's mtime changed. Returns 1 if it was reloaded.
+int computersRefresh();
+
+// NULL if there is no such computer
+struct Computer * computerByGui(int gui_id);
+struct Computer * computerById(int id);
+
+#endif
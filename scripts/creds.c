@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "creds.h"
+#include "computers.h"
+#include "intmap.h"
+
+struct Pin {
+	char s[MAX_PIN_LEN + 1];
+	int next; // next pin of the same computer, -1 if none
+};
+
+static struct Pin * pins = NULL;
+static int cnt_pins = 0;
+static struct IntMap first_pin; // computer id -> index in 'pins'
+
+static char pincodes_path[256] = PINCODES_FILE;
+static struct timespec pincodes_mtime;
+
+static int loadPincodes() {
+	FILE * f = fopen(pincodes_path, "r");
+	if (f == NULL) return -1;
+
+	struct stat st;
+	if (fstat(fileno(f), &st) == 0) pincodes_mtime = st.st_mtim;
+
+	int cap = 64, cnt = 0;
+	struct Pin * table = (struct Pin *) malloc(sizeof(struct Pin) * cap);
+	if (pins == NULL) intMapInit(&first_pin, 64);
+	else intMapClear(&first_pin);
+
+	char line[1024];
+	while (fgets(line, sizeof(line), f)) {
+		char * save;
+		char * tok = strtok_r(line, " \t\r\n", &save);
+		if (tok == NULL) continue;
+		char * end;
+		long comp = strtol(tok, &end, 10);
+		if (*end || comp < 0) continue;
+
+		while ((tok = strtok_r(NULL, " \t\r\n", &save)) != NULL) {
+			if (strlen(tok) > MAX_PIN_LEN) continue;
+			if (cnt == cap) {
+				cap *= 2;
+				table = (struct Pin *) realloc(table, sizeof(struct Pin) * cap);
+			}
+			strcpy(table[cnt].s, tok);
+			table[cnt].next = intMapGet(&first_pin, comp, -1);
+			intMapPut(&first_pin, comp, cnt);
+			cnt++;
+		}
+	}
+	fclose(f);
+
+	free(pins);
+	pins = table;
+	cnt_pins = cnt;
+	return 0;
+}
+
+int credsInit(const char * computers_path, const char * pincodes) {
+	strncpy(pincodes_path, pincodes, sizeof(pincodes_path) - 1);
+	int res = 0;
+	if (computersLoad(computers_path) < 0) {
+		fprintf(stderr, "Can't read %s\n", computers_path);
+		res = -1;
+	}
+	if (loadPincodes() < 0) {
+		fprintf(stderr, "Can't read %s\n", pincodes_path);
+		res = -1;
+	}
+	return res;
+}
+
+void credsRefresh() {
+	computersRefresh();
+
+	struct stat st;
+	if (stat(pincodes_path, &st) != 0) return;
+	if (pins != NULL && st.st_mtim.tv_sec == pincodes_mtime.tv_sec
+		&& st.st_mtim.tv_nsec == pincodes_mtime.tv_nsec) return;
+	loadPincodes();
+}
+
+int credsCheck(int gui_id, const char * pswd, int * comp) {
+	struct Computer * c = computerByGui(gui_id);
+	*comp = c ? c->id : -1;
+	if (c == NULL || pswd[0] == 0) return 0;
+
+	for (int i = intMapGet(&first_pin, c->id, -1); i >= 0; i = pins[i].next) {
+		if (strcmp(pins[i].s, pswd) == 0) return 1;
+	}
+	return 0;
+}
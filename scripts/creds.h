@@ -0,0 +1,22 @@
+#ifndef CREDS_H
+#define CREDS_H
+
+#define PINCODES_FILE "pincodes.txt"
+#define MAX_PIN_LEN 15
+
+/*
+	One line of pincodes.txt: "<computer id> <pin> [<pin> ...]"
+	A computer may appear on several lines.
+*/
+
+// Loads computers.txt and pincodes.txt. Returns 0 on success, -1 if one of them can't be read.
+int credsInit(const char * computers_path, const char * pincodes_path);
+
+// Reloads the files whose mtime changed since the last load
+void credsRefresh();
+
+// 1 if 'pswd' is one of the pins of the computer shown as icon 'gui_id'.
+// 'comp' gets the physical computer id or -1.
+int credsCheck(int gui_id, const char * pswd, int * comp);
+
+#endif
@@ -0,0 +1,161 @@
+import sys
+
+# Compiles layout.txt into C tables (layout_gen.h) so buildScenes() does no layout math.
+# Usage: python3 gen_layout.py layout.txt > layout_gen.h
+
+
+def fail(n, msg):
+	sys.stderr.write('layout: line %i: %s\n' % (n, msg))
+	exit(1)
+
+
+# Labels are centered with the advance of Courier New, 0.52 em
+def label(x, y, chars, font):
+	return x, -round(chars * font * 0.26), y, round(font * 0.26)
+
+
+def item(touch, margin, font, chars, scene=0, target=0, ch='\0'):
+	x1, y1, x2, y2 = touch
+	box = (x1 + margin, y1 + margin, x2 - margin, y2 - margin)
+	tx, tdx, ty, tdy = label((x1 + x2) // 2, (y1 + y2) // 2, chars, font)
+	return [scene, target, touch, box, tx, tdx, ty, tdy, font, ch]
+
+
+def grid(cols, rows, x1, y1, x2, y2):
+	cells = []
+	for i in range(rows):
+		for j in range(cols):
+			cells.append((j * (x2 - x1) // cols + x1, i * (y2 - y1) // rows + y1,
+				(j + 1) * (x2 - x1) // cols + x1, (i + 1) * (y2 - y1) // rows + y1))
+	return cells
+
+
+def ints(n, words, cnt):
+	if len(words) < cnt:
+		fail(n, 'expected %i numbers' % cnt)
+	try:
+		return [int(w) for w in words[:cnt]]
+	except ValueError:
+		fail(n, 'expected %i numbers' % cnt)
+
+
+screen = None
+tiles = []
+pages = []
+cnt_icons = 0
+keys = []
+backs = []
+buttons = {}
+# Page arrows and the buttons of the return time picker
+button_names = ('left', 'right', 'earlier', 'later', 'ok')
+
+lines = open(sys.argv[1]).read().split('\n')
+for n, line in enumerate(lines, 1):
+	words = line.split('#')[0].split()
+	if not words:
+		continue
+	cmd, args = words[0], words[1:]
+	if cmd == 'screen':
+		screen = ints(n, args, 2)
+	elif cmd == 'icons':
+		cnt, cols, rows, x1, y1, x2, y2, margin, font = ints(n, args, 9)
+		# Pages of this line share one set of tiles. Names are filled in by the program,
+		# their length is known at the end.
+		tile = len(tiles)
+		for cell in grid(cols, rows, x1, y1, x2, y2):
+			tiles.append((cell, margin, font))
+		for first in range(0, cnt, cols * rows):
+			pages.append((cnt_icons + first, min(cols * rows, cnt - first), tile))
+		cnt_icons += cnt
+	elif cmd == 'button':
+		if len(args) != 8 or args[0] not in button_names:
+			fail(n, 'expected button <%s> <x1> <y1> <x2> <y2> <margin> <font> <label>' % '|'.join(button_names))
+		x1, y1, x2, y2, margin, font = ints(n, args[1:], 6)
+		buttons[args[0]] = item((x1, y1, x2, y2), margin, font, 1, ch=args[7][0])
+	elif cmd == 'keypad':
+		if len(args) != 9:
+			fail(n, 'expected keypad <cols> <rows> <x1> <y1> <x2> <y2> <margin> <font> <labels>')
+		cols, rows, x1, y1, x2, y2, margin, font = ints(n, args, 8)
+		if len(args[8]) != cols * rows:
+			fail(n, '%i labels for %i keys' % (len(args[8]), cols * rows))
+		for cell, ch in zip(grid(cols, rows, x1, y1, x2, y2), args[8]):
+			keys.append(item(cell, margin, font, 1, ch=ch))
+	elif cmd == 'back':
+		if len(args) != 8:
+			fail(n, 'expected back <scene> <target scene> <x1> <y1> <x2> <y2> <font> <label>')
+		scene, target, x1, y1, x2, y2, font = ints(n, args, 7)
+		backs.append(item((x1, y1, x2, y2), 0, font, 1, scene=scene, target=target, ch=args[7][0]))
+	else:
+		fail(n, 'unknown "%s"' % cmd)
+
+if screen is None:
+	fail(len(lines), 'no screen')
+if not pages:
+	fail(len(lines), 'no icons')
+for name in button_names:
+	if name not in buttons:
+		fail(len(lines), 'no %s button' % name)
+
+name_len = len(str(cnt_icons - 1))
+if name_len < 2:
+	name_len = 2
+tiles = [item(cell, margin, font, name_len) for cell, margin, font in tiles]
+
+
+def rect(r):
+	return '{%i, %i, %i, %i}' % r
+
+
+def cchar(c):
+	if c == '\0':
+		return "0"
+	if c in "\\'":
+		return "'\\%s'" % c
+	return "'%s'" % c
+
+
+def row(it):
+	scene, target, touch, box, tx, tdx, ty, tdy, font, ch = it
+	return '{%i, %i, %s, %s, %i, %i, %i, %i, %i, %s}' % (scene, target, rect(touch), rect(box),
+		tx, tdx, ty, tdy, font, cchar(ch))
+
+
+def table(name, items):
+	out = ['static const struct LayoutItem %s[%i] = {' % (name, len(items))]
+	for it in items:
+		out.append('\t%s,' % row(it))
+	out.append('};')
+	return '\n'.join(out)
+
+
+print('// Generated from %s by gen_layout.py, don\'t edit' % sys.argv[1])
+print('#ifndef LAYOUT_GEN_H')
+print('#define LAYOUT_GEN_H')
+print()
+print('#include "layout.h"')
+print()
+print('#define LAYOUT_WIDTH %i' % screen[0])
+print('#define LAYOUT_HEIGHT %i' % screen[1])
+print('#define LAYOUT_ICONS %i' % cnt_icons)
+print('#define LAYOUT_PAGES %i' % len(pages))
+print('// Icons on the fullest page')
+print('#define LAYOUT_TILES %i' % max(cnt for first, cnt, tile in pages))
+print('#define LAYOUT_KEYS %i' % len(keys))
+print('#define LAYOUT_BACKS %i' % len(backs))
+print('#define LAYOUT_NAME_LEN %i' % name_len)
+print()
+print(table('layout_tiles', tiles))
+print()
+print('static const struct LayoutPage layout_pages[%i] = {' % len(pages))
+for first, cnt, tile in pages:
+	print('\t{%i, %i, %i},' % (first, cnt, tile))
+print('};')
+print()
+print(table('layout_keys', keys))
+print()
+print(table('layout_backs', backs))
+print()
+for name in button_names:
+	print('static const struct LayoutItem layout_%s = %s;' % (name, row(buttons[name])))
+print()
+print('#endif')
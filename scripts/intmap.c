@@ -0,0 +1,66 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "intmap.h"
+
+#define EMPTY_KEY -1
+
+static unsigned int hashInt(int key) {
+	unsigned int h = (unsigned int) key;
+	h ^= h >> 16;
+	h *= 0x45d9f3b;
+	h ^= h >> 16;
+	return h;
+}
+
+void intMapInit(struct IntMap * map, int cap) {
+	int c = 16;
+	while (c < cap * 2) c *= 2;
+	map->cap = c;
+	map->cnt = 0;
+	map->keys = (int *) malloc(sizeof(int) * c);
+	map->vals = (int *) malloc(sizeof(int) * c);
+	memset(map->keys, 0xff, sizeof(int) * c);
+}
+
+void intMapFree(struct IntMap * map) {
+	free(map->keys);
+	free(map->vals);
+	map->keys = map->vals = NULL;
+	map->cap = map->cnt = 0;
+}
+
+void intMapClear(struct IntMap * map) {
+	memset(map->keys, 0xff, sizeof(int) * map->cap);
+	map->cnt = 0;
+}
+
+static void grow(struct IntMap * map) {
+	struct IntMap old = *map;
+	intMapInit(map, old.cap);
+	for (int i = 0; i < old.cap; i++) {
+		if (old.keys[i] != EMPTY_KEY) intMapPut(map, old.keys[i], old.vals[i]);
+	}
+	intMapFree(&old);
+}
+
+void intMapPut(struct IntMap * map, int key, int val) {
+	if ((map->cnt + 1) * 2 > map->cap) grow(map);
+	unsigned int i = hashInt(key) & (map->cap - 1);
+	while (map->keys[i] != EMPTY_KEY && map->keys[i] != key) {
+		i = (i + 1) & (map->cap - 1);
+	}
+	if (map->keys[i] == EMPTY_KEY) map->cnt++;
+	map->keys[i] = key;
+	map->vals[i] = val;
+}
+
+int intMapGet(struct IntMap * map, int key, int def) {
+	if (key < 0 || map->cap == 0) return def;
+	unsigned int i = hashInt(key) & (map->cap - 1);
+	while (map->keys[i] != EMPTY_KEY) {
+		if (map->keys[i] == key) return map->vals[i];
+		i = (i + 1) & (map->cap - 1);
+	}
+	return def;
+}
@@ -0,0 +1,18 @@
+#ifndef INTMAP_H
+#define INTMAP_H
+
+// Open addressing hash table int -> int. Keys must be >= 0.
+struct IntMap {
+	int cap, cnt;
+	int * keys;
+	int * vals;
+};
+
+void intMapInit(struct IntMap * map, int cap);
+void intMapFree(struct IntMap * map);
+void intMapClear(struct IntMap * map);
+void intMapPut(struct IntMap * map, int key, int val);
+// Returns 'def' if there is no such key
+int intMapGet(struct IntMap * map, int key, int def);
+
+#endif
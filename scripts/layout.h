@@ -0,0 +1,24 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+// The tables are generated from layout.txt into layout_gen.h, see gen_layout.py
+
+struct LayoutRect {
+	int x1, y1, x2, y2;
+};
+
+// Tile of an icon page, key or button
+struct LayoutItem {
+	int scene, target;	// back buttons: shown in 'scene', go to 'target'
+	struct LayoutRect touch;
+	struct LayoutRect box;	// drawn box
+	int text_x, text_dx, text_y, text_dy, font_size;
+	char label;			// keys and buttons
+};
+
+// Icons first .. first + cnt - 1 are shown in layout_tiles[tile] .. layout_tiles[tile + cnt - 1]
+struct LayoutPage {
+	int first, cnt, tile;
+};
+
+#endif
@@ -0,0 +1,129 @@
+#include <pigpio.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "locks.h"
+#include "spsc.h"
+#include "status.h"
+
+#define QUEUE_SIZE 16
+
+struct LockPins {
+	int relay, sense, level;
+};
+
+struct LockCommand {
+	int comp, group, open;
+	int stop;
+	long t;
+};
+
+static struct LockPins pins[MAX_GROUPS];
+static struct Spsc commands, results;
+static sem_t wake;
+static pthread_t thread;
+static int running = 0;
+
+static int actuate(struct LockPins * p, int open) {
+	int level = open ? p->level : !p->level;
+	gpioWrite(p->relay, level);
+	if (p->sense < 0) return LOCK_OK;
+
+	long deadline = monotonicUs() + LOCK_TIMEOUT_MS * 1000L;
+	while (gpioRead(p->sense) != level) {
+		if (monotonicUs() > deadline) return LOCK_TIMEOUT;
+		gpioDelay(1000);
+	}
+	return LOCK_OK;
+}
+
+static void * actuator(void * arg) {
+	struct LockCommand cmd;
+	while (1) {
+		sem_wait(&wake);
+		if (!spscPop(&commands, &cmd)) continue;
+		if (cmd.stop) break;
+
+		struct LockResult r;
+		r.comp = cmd.comp;
+		r.group = cmd.group;
+		r.open = cmd.open;
+		if (cmd.group < 0 || cmd.group >= MAX_GROUPS || pins[cmd.group].relay < 0) {
+			r.res = LOCK_NO_RELAY;
+		} else {
+			r.res = actuate(&pins[cmd.group], cmd.open);
+		}
+		r.us = monotonicUs() - cmd.t;
+		// If the UI doesn't read the results the ring fills up and the newest ones are lost
+		spscPush(&results, &r);
+	}
+	return NULL;
+}
+
+int locksInit(const char * path) {
+	for (int i = 0; i < MAX_GROUPS; i++) {
+		pins[i].relay = pins[i].sense = -1;
+		pins[i].level = 1;
+	}
+
+	FILE * f = fopen(path, "r");
+	if (f == NULL) {
+		fprintf(stderr, "Can't read %s, locks won't be driven\n", path);
+	} else {
+		char line[256];
+		while (fgets(line, sizeof(line), f)) {
+			int group, relay, sense = -1, level = 1;
+			if (sscanf(line, "%d %d %d %d", &group, &relay, &sense, &level) < 2) continue;
+			if (group < 0 || group >= MAX_GROUPS) continue;
+			pins[group].relay = relay;
+			pins[group].sense = sense;
+			pins[group].level = level ? 1 : 0;
+			gpioSetMode(relay, PI_OUTPUT);
+			gpioWrite(relay, !pins[group].level);
+			if (sense >= 0) gpioSetMode(sense, PI_INPUT);
+		}
+		fclose(f);
+	}
+
+	spscInit(&commands, QUEUE_SIZE, sizeof(struct LockCommand));
+	spscInit(&results, QUEUE_SIZE, sizeof(struct LockResult));
+	sem_init(&wake, 0, 0);
+	if (pthread_create(&thread, NULL, actuator, NULL) != 0) {
+		perror("pthread_create");
+		return -1;
+	}
+	running = 1;
+	return 0;
+}
+
+int lockRequest(int comp, int group, int open) {
+	struct LockCommand cmd;
+	cmd.comp = comp;
+	cmd.group = group;
+	cmd.open = open;
+	cmd.stop = 0;
+	cmd.t = monotonicUs();
+	if (!running || !spscPush(&commands, &cmd)) return -1;
+	sem_post(&wake);
+	return 0;
+}
+
+int lockPoll(struct LockResult * res) {
+	if (!running) return 0;
+	return spscPop(&results, res);
+}
+
+void locksClose() {
+	if (!running) return;
+	struct LockCommand cmd;
+	memset(&cmd, 0, sizeof(cmd));
+	cmd.stop = 1;
+	while (!spscPush(&commands, &cmd)) {
+		gpioDelay(1000);
+	}
+	sem_post(&wake);
+	pthread_join(thread, NULL);
+	running = 0;
+}
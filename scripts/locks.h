@@ -0,0 +1,40 @@
+#ifndef LOCKS_H
+#define LOCKS_H
+
+#define LOCKS_FILE "locks.txt"
+#define MAX_GROUPS 16
+// How long the sense pin may take to follow the relay
+#define LOCK_TIMEOUT_MS 500
+
+/*
+	One line of locks.txt: "<group> <relay gpio> [<sense gpio> [<active level>]]"
+
+sense gpio   - input that reads the lock state back, -1 if there is none
+active level - level of the relay gpio that opens the lock (1 by default)
+*/
+
+enum {
+	LOCK_OK,
+	LOCK_TIMEOUT,	// sense pin didn't follow the relay, the relay is probably stuck
+	LOCK_NO_RELAY	// group has no line in locks.txt
+};
+
+struct LockResult {
+	int comp, group, open;
+	int res;
+	long us; // time from the request to the completion
+};
+
+// Reads locks.txt and starts the actuator thread. gpioInitialise() must be called before.
+int locksInit(const char * path);
+
+// Never blocks. 'comp' is a GUI id. Returns -1 if the queue is full.
+int lockRequest(int comp, int group, int open);
+
+// Non-blocking, for the UI thread. Returns 1 and fills 'res' if some request has completed.
+int lockPoll(struct LockResult * res);
+
+// Stops the thread after the queued requests are done
+void locksClose();
+
+#endif
@@ -0,0 +1,80 @@
+/*
+	Prints the access log written by accesslog.c.
+
+	./logdump [file] [csv|text] [file]
+
+	csv  - "time,seq,gui_id,comp,outcome,photo", one line per attempt (default)
+	text - the sentences logs.txt used to have
+	The log doesn't say which camera backend took the photos, the paths are those of
+	raspistill. 'file' gives the paths of CAMERA=file runs instead.
+*/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "accesslog.h"
+#include "camera.h"
+
+const char * outcomeName(int outcome) {
+	if (outcome == ACCESS_GRANTED) return "granted";
+	if (outcome == ACCESS_RESERVED) return "reserved";
+	if (outcome == ACCESS_CANCELLED) return "cancelled";
+	return "denied";
+}
+
+int main(int argc, char * argv[]) {
+	const char * path = argc > 1 ? argv[1] : ACCESS_LOG_FILE;
+	int text = argc > 2 && strcmp(argv[2], "text") == 0;
+	struct CameraBackend * camera = argc > 3 && strcmp(argv[3], "file") == 0 ? &camera_file : &camera_raspistill;
+
+	FILE * f = fopen(path, "rb");
+	if (f == NULL) {
+		perror(path);
+		return 1;
+	}
+	struct AccessLogHeader h;
+	if (fread(&h, sizeof(h), 1, f) != 1 || h.magic != ACCESS_LOG_MAGIC) {
+		fprintf(stderr, "%s is not an access log\n", path);
+		return 1;
+	}
+	if (h.version != ACCESS_LOG_VERSION || h.record_size != sizeof(struct AccessRecord)) {
+		fprintf(stderr, "%s: version %u with %u byte records, expected version %i\n", path, h.version,
+			h.record_size, ACCESS_LOG_VERSION);
+		return 1;
+	}
+
+	if (!text) printf("time,seq,gui_id,comp,outcome,photo\n");
+	struct AccessRecord r;
+	long cnt = 0;
+	while (fread(&r, sizeof(r), 1, f) == 1) {
+		// Records are fixed size, the next one is still where it should be
+		if (r.check != accessLogCheck(&r)) {
+			fprintf(stderr, "%s: record %ld is broken, skipping it\n", path, cnt++);
+			continue;
+		}
+		cnt++;
+
+		char date[32], photo[256] = "";
+		struct tm tm;
+		time_t t = r.t_us / 1000000;
+		localtime_r(&t, &tm);
+		strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &tm);
+		if (r.photo >= 0) {
+			struct CameraJob job;
+			job.attempt = r.photo;
+			job.t = t;
+			cameraPhotoPath(&job, camera->ext, photo, sizeof(photo));
+		}
+
+		if (text) {
+			printf("%s %s match with [%i] at icon %i%s%s%s\n", date, r.outcome == ACCESS_DENIED ? "Did not get" : "Got",
+				r.comp, r.gui_id, r.outcome == ACCESS_RESERVED ? ", reserved" : r.outcome == ACCESS_CANCELLED ?
+				", not taken" : "", photo[0] ? ", photo " : "", photo);
+		} else {
+			printf("%s.%06ld,%u,%i,%i,%s,%s\n", date, (long) (r.t_us % 1000000), r.seq, r.gui_id, r.comp,
+				outcomeName(r.outcome), photo);
+		}
+	}
+	fclose(f);
+	return 0;
+}
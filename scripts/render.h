@@ -0,0 +1,59 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+/*
+	Everything drawRect()/drawBox()/drawText() need from the screen.
+	render_nvg.c draws on the TFT through nanovg, render_raster.c into memory.
+	Coordinates are in pixels, colors are 0-255.
+*/
+struct RenderBackend {
+	const char * name;
+	int width, height;
+
+	// Returns font id or -1
+	int (*createFont)(const char * name, const char * path);
+
+	void (*beginFrame)();
+	// Finishes the frame and shows it
+	void (*endFrame)();
+
+	// Nothing is drawn outside of the clip area until resetClip()
+	void (*clip)(int x, int y, int w, int h);
+	void (*resetClip)();
+
+	void (*fillRect)(int x1, int y1, int x2, int y2, int r, int g, int b, int a);
+	// Outline of width 'w' centered on the border of the rectangle
+	void (*strokeRect)(int x1, int y1, int x2, int y2, int w, int r, int g, int b, int a);
+	// (x, y) is the left end of the baseline
+	void (*text)(int font, int size, int x, int y, const char * s, int len, int r, int g, int b, int a);
+	// bounds: x1, y1, x2, y2
+	void (*textBounds)(int font, int size, int x, int y, const char * s, int len, float * bounds);
+
+	// Optional, see textcache.h. Draws 's' into the text atlas of the backend and returns a
+	// handle for drawPrepared(), -1 if it doesn't fit. Not called during a frame.
+	int (*prepareText)(int font, int size, const char * s, int len);
+	// Same as text() for the string prepared as 'handle'
+	void (*drawPrepared)(int handle, int x, int y, int r, int g, int b, int a);
+
+	// Optional offscreen layers of the size of the screen, see drawScene(). Returns -1 on failure.
+	int (*createLayer)();
+	// Until endLayer() everything is drawn into 'layer'. Not called during a frame.
+	void (*beginLayer)(int layer);
+	void (*endLayer)();
+	// Copies 'layer' to the screen inside of the clip area
+	void (*drawLayer)(int layer);
+};
+
+extern struct RenderBackend * render;
+
+// Shelf packer for the text atlases of the backends
+struct AtlasPacker {
+	int width, height;
+	int x, y, row_h;
+};
+
+void atlasInit(struct AtlasPacker * p, int width, int height);
+// Finds a place for a w x h cell. Returns 0 if the atlas is full.
+int atlasPack(struct AtlasPacker * p, int w, int h, int * x, int * y);
+
+#endif
@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <math.h>
+
+// Add TFTGL library
+#include <tftgl.h>
+
+// Add NANOVG library
+#include <nanovg.h>
+#define NANOVG_GLES2_IMPLEMENTATION	// Use GLES 2 implementation.
+#include <nanovg_gl.h>
+#include <nanovg_gl_utils.h>
+
+#include "render_nvg.h"
+
+struct NVGcontext* vg;
+static GLint width, height;
+
+static int nvgRenderCreateFont(const char * name, const char * path) {
+	return nvgCreateFont(vg, name, path);
+}
+
+static void nvgRenderBeginFrame() {
+	nvgBeginFrame(vg, width, height, 1.0);
+}
+
+static void nvgRenderEndFrame() {
+	nvgEndFrame(vg);
+	tftglUploadFbo();
+}
+
+static void nvgRenderClip(int x, int y, int w, int h) {
+	nvgScissor(vg, x, y, w, h);
+}
+
+static void nvgRenderResetClip() {
+	nvgResetScissor(vg);
+}
+
+static void nvgRenderFillRect(int x1, int y1, int x2, int y2, int r, int g, int b, int a) {
+	nvgBeginPath(vg);
+	nvgMoveTo(vg, x1, y1);
+	nvgLineTo(vg, x2, y1);
+	nvgLineTo(vg, x2, y2);
+	nvgLineTo(vg, x1, y2);
+	nvgLineTo(vg, x1, y1);
+	nvgFillColor(vg, nvgRGBA(r, g, b, a));
+	nvgFill(vg);
+}
+
+static void nvgRenderStrokeRect(int x1, int y1, int x2, int y2, int w, int r, int g, int b, int a) {
+	nvgBeginPath(vg);
+	nvgMoveTo(vg, x1, y1);
+	nvgLineTo(vg, x2, y1);
+	nvgLineTo(vg, x2, y2);
+	nvgLineTo(vg, x1, y2);
+	nvgLineTo(vg, x1, y1);
+	nvgStrokeColor(vg, nvgRGBA(r, g, b, a));
+	nvgStrokeWidth(vg, w);
+	nvgStroke(vg);
+}
+
+static void nvgRenderText(int font, int size, int x, int y, const char * s, int len, int r, int g, int b, int a) {
+	nvgFontFaceId(vg, font);
+	nvgFontSize(vg, size);
+	nvgFillColor(vg, nvgRGBA(r, g, b, a));
+	nvgText(vg, x, y, s, s + len);
+}
+
+static void nvgRenderTextBounds(int font, int size, int x, int y, const char * s, int len, float * bounds) {
+	nvgFontFaceId(vg, font);
+	nvgFontSize(vg, size);
+	nvgTextBounds(vg, x, y, s, s + len, bounds);
+}
+
+// TEXT ATLAS
+// Prepared strings are drawn once in white into an offscreen framebuffer, drawing one is
+// a single textured quad tinted with the text color
+
+#define NVG_ATLAS_W 1024
+#define NVG_ATLAS_H 1024
+#define MAX_NVG_RUNS 256
+
+struct NvgRun {
+	int ax, ay;		// cell in the atlas
+	int w, h;
+	int ox, oy;		// top left corner of the cell relative to the baseline origin
+};
+
+static NVGLUframebuffer * atlas = NULL;
+static struct AtlasPacker packer;
+static struct NvgRun runs[MAX_NVG_RUNS];
+static int cnt_runs = 0;
+
+static int nvgRenderPrepareText(int font, int size, const char * s, int len) {
+	if (atlas == NULL || cnt_runs == MAX_NVG_RUNS || len == 0) return -1;
+
+	float b[4];
+	nvgRenderTextBounds(font, size, 0, 0, s, len, b);
+	struct NvgRun * run = &runs[cnt_runs];
+	// 1 pixel of padding against bleeding of the neighbours
+	run->ox = (int) floorf(b[0]) - 1;
+	run->oy = (int) floorf(b[1]) - 1;
+	run->w = (int) ceilf(b[2]) + 1 - run->ox;
+	run->h = (int) ceilf(b[3]) + 1 - run->oy;
+	if (!atlasPack(&packer, run->w, run->h, &run->ax, &run->ay)) return -1;
+
+	nvgluBindFramebuffer(atlas);
+	glViewport(0, 0, NVG_ATLAS_W, NVG_ATLAS_H);
+	nvgBeginFrame(vg, NVG_ATLAS_W, NVG_ATLAS_H, 1.0);
+	nvgFontFaceId(vg, font);
+	nvgFontSize(vg, size);
+	nvgFillColor(vg, nvgRGBA(255, 255, 255, 255));
+	nvgText(vg, run->ax - run->ox, run->ay - run->oy, s, s + len);
+	nvgEndFrame(vg);
+	// Back to the framebuffer of tftgl
+	nvgluBindFramebuffer(NULL);
+	glViewport(0, 0, width, height);
+	return cnt_runs++;
+}
+
+static void nvgRenderDrawPrepared(int handle, int x, int y, int r, int g, int b, int a) {
+	struct NvgRun * run = &runs[handle];
+	int x1 = x + run->ox, y1 = y + run->oy;
+	NVGpaint paint = nvgImagePattern(vg, x1 - run->ax, y1 - run->ay, NVG_ATLAS_W, NVG_ATLAS_H, 0, atlas->image, 1.0);
+	// The atlas is white, the shader multiplies it with the inner color
+	paint.innerColor = paint.outerColor = nvgRGBA(r, g, b, a);
+	nvgBeginPath(vg);
+	nvgRect(vg, x1, y1, run->w, run->h);
+	nvgFillPaint(vg, paint);
+	nvgFill(vg);
+}
+
+static void createAtlas() {
+	atlas = nvgluCreateFramebuffer(vg, NVG_ATLAS_W, NVG_ATLAS_H, NVG_IMAGE_FLIPY | NVG_IMAGE_PREMULTIPLIED);
+	if (atlas == NULL) {
+		fprintf(stderr, "Failed to create the text atlas, texts are drawn directly\n");
+		return;
+	}
+	nvgluBindFramebuffer(atlas);
+	glClearColor(0, 0, 0, 0);
+	glClear(GL_COLOR_BUFFER_BIT);
+	nvgluBindFramebuffer(NULL);
+	atlasInit(&packer, NVG_ATLAS_W, NVG_ATLAS_H);
+	cnt_runs = 0;
+}
+// TEXT ATLAS
+
+// LAYERS
+
+#define MAX_NVG_LAYERS 8
+
+static NVGLUframebuffer * layers[MAX_NVG_LAYERS];
+static int cnt_layers = 0;
+
+static int nvgRenderCreateLayer() {
+	if (cnt_layers == MAX_NVG_LAYERS) return -1;
+	layers[cnt_layers] = nvgluCreateFramebuffer(vg, width, height, NVG_IMAGE_FLIPY | NVG_IMAGE_PREMULTIPLIED);
+	if (layers[cnt_layers] == NULL) {
+		fprintf(stderr, "Failed to create a scene layer\n");
+		return -1;
+	}
+	return cnt_layers++;
+}
+
+static void nvgRenderBeginLayer(int layer) {
+	nvgluBindFramebuffer(layers[layer]);
+	glViewport(0, 0, width, height);
+	glClearColor(0, 0, 0, 1);
+	glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+	nvgBeginFrame(vg, width, height, 1.0);
+}
+
+static void nvgRenderEndLayer() {
+	nvgEndFrame(vg);
+	nvgluBindFramebuffer(NULL);
+}
+
+static void nvgRenderDrawLayer(int layer) {
+	NVGpaint paint = nvgImagePattern(vg, 0, 0, width, height, 0, layers[layer]->image, 1.0);
+	nvgBeginPath(vg);
+	nvgRect(vg, 0, 0, width, height);
+	nvgFillPaint(vg, paint);
+	nvgFill(vg);
+}
+// LAYERS
+
+static struct RenderBackend render_nvg = {
+	"nanovg", 0, 0,
+	nvgRenderCreateFont,
+	nvgRenderBeginFrame,
+	nvgRenderEndFrame,
+	nvgRenderClip,
+	nvgRenderResetClip,
+	nvgRenderFillRect,
+	nvgRenderStrokeRect,
+	nvgRenderText,
+	nvgRenderTextBounds,
+	nvgRenderPrepareText,
+	nvgRenderDrawPrepared,
+	nvgRenderCreateLayer,
+	nvgRenderBeginLayer,
+	nvgRenderEndLayer,
+	nvgRenderDrawLayer
+};
+
+struct RenderBackend * renderNvgInit() {
+	// Initialize tftgl!
+	if(tftglInit(TFTGL_LANDSCAPE) != TFTGL_OK){
+		fprintf(stderr, "Failed to initialize TFTGL library! Error: %s\n",
+			tftglGetErrorStr());
+		return NULL;
+	}
+
+	// Set brightness to full 100%
+	tftgSetBrightness(255);
+
+	// Get viewport size
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	printf("TFT display initialized with EGL! Screen size: %dx%d\n",
+		viewport[2], viewport[3]);
+
+	width = render_nvg.width = viewport[2];
+	height = render_nvg.height = viewport[3];
+
+	glClear(GL_COLOR_BUFFER_BIT|GL_STENCIL_BUFFER_BIT);
+	vg = nvgCreateGLES2(NVG_ANTIALIAS | NVG_STENCIL_STROKES);
+	createAtlas();
+	return &render_nvg;
+}
+
+void renderNvgClose() {
+	if (atlas) nvgluDeleteFramebuffer(atlas);
+	for (int i = 0; i < cnt_layers; i++) nvgluDeleteFramebuffer(layers[i]);
+	nvgDeleteGLES2(vg);
+}
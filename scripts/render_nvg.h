@@ -0,0 +1,10 @@
+#ifndef RENDER_NVG_H
+#define RENDER_NVG_H
+
+#include "render.h"
+
+// Initializes tftgl and nanovg. Returns NULL on error.
+struct RenderBackend * renderNvgInit();
+void renderNvgClose();
+
+#endif
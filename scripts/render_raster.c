@@ -0,0 +1,315 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "render_raster.h"
+
+uint32_t * raster_fb = NULL;
+struct RasterStats raster_stats;
+
+static int fb_width, fb_height;
+static int cx1, cy1, cx2, cy2; // clip area, x2 and y2 are exclusive
+
+struct Glyph {
+	char c;
+	unsigned char rows[7]; // 5 bits per row, the highest one is the left pixel
+};
+
+static const struct Glyph glyphs[] = {
+	{'0', {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}},
+	{'1', {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}},
+	{'2', {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}},
+	{'3', {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}},
+	{'4', {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}},
+	{'5', {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}},
+	{'6', {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}},
+	{'7', {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}},
+	{'8', {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}},
+	{'9', {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}},
+	{'<', {0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02}},
+	{'>', {0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08}},
+	{'*', {0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00}},
+	{':', {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}},
+	{' ', {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}},
+};
+
+static const struct Glyph unknown = {'?', {0x1F, 0x11, 0x11, 0x11, 0x11, 0x11, 0x1F}};
+
+static const struct Glyph * findGlyph(char c) {
+	for (unsigned int i = 0; i < sizeof(glyphs) / sizeof(glyphs[0]); i++) {
+		if (glyphs[i].c == c) return &glyphs[i];
+	}
+	return &unknown;
+}
+
+static void span(int x1, int y1, int x2, int y2, int r, int g, int b, int a) {
+	if (x1 < cx1) x1 = cx1;
+	if (y1 < cy1) y1 = cy1;
+	if (x2 > cx2) x2 = cx2;
+	if (y2 > cy2) y2 = cy2;
+	if (x1 >= x2 || y1 >= y2 || a == 0) return;
+
+	raster_stats.fills++;
+	raster_stats.pixels += (long) (x2 - x1) * (y2 - y1);
+	uint32_t color = 0xff000000u | (r << 16) | (g << 8) | b;
+	for (int y = y1; y < y2; y++) {
+		uint32_t * p = raster_fb + y * fb_width;
+		if (a == 255) {
+			for (int x = x1; x < x2; x++) p[x] = color;
+			continue;
+		}
+		for (int x = x1; x < x2; x++) {
+			uint32_t d = p[x];
+			int dr = (d >> 16) & 0xff, dg = (d >> 8) & 0xff, db = d & 0xff;
+			dr += (r - dr) * a / 255;
+			dg += (g - dg) * a / 255;
+			db += (b - db) * a / 255;
+			p[x] = 0xff000000u | (dr << 16) | (dg << 8) | db;
+		}
+	}
+}
+
+static int rasterCreateFont(const char * name, const char * path) {
+	return 0;
+}
+
+static void rasterBeginFrame() {
+}
+
+static void rasterEndFrame() {
+	raster_stats.frames++;
+}
+
+static void rasterClip(int x, int y, int w, int h) {
+	cx1 = x < 0 ? 0 : x;
+	cy1 = y < 0 ? 0 : y;
+	cx2 = x + w > fb_width ? fb_width : x + w;
+	cy2 = y + h > fb_height ? fb_height : y + h;
+}
+
+static void rasterResetClip() {
+	rasterClip(0, 0, fb_width, fb_height);
+}
+
+static void rasterFillRect(int x1, int y1, int x2, int y2, int r, int g, int b, int a) {
+	if (x2 < x1) {
+		int t = x1;
+		x1 = x2;
+		x2 = t;
+	}
+	if (y2 < y1) {
+		int t = y1;
+		y1 = y2;
+		y2 = t;
+	}
+	span(x1, y1, x2, y2, r, g, b, a);
+}
+
+static void rasterStrokeRect(int x1, int y1, int x2, int y2, int w, int r, int g, int b, int a) {
+	int h1 = w / 2, h2 = w - w / 2;
+	span(x1 - h1, y1 - h1, x2 + h2, y1 + h2, r, g, b, a);
+	span(x1 - h1, y2 - h1, x2 + h2, y2 + h2, r, g, b, a);
+	span(x1 - h1, y1 + h2, x1 + h2, y2 - h1, r, g, b, a);
+	span(x2 - h1, y1 + h2, x2 + h2, y2 - h1, r, g, b, a);
+}
+
+// Calls 'out' for every run of set pixels of the glyphs, (x, y) is the left end of the baseline
+static void glyphSpans(int size, int x, int y, const char * s, int len, void (*out)(int x1, int y1, int x2, int y2)) {
+	int px = size / 10;
+	if (px < 1) px = 1;
+	int top = y - 7 * px;
+	for (int i = 0; i < len; i++) {
+		const struct Glyph * gl = findGlyph(s[i]);
+		int gx = x + i * size * 3 / 5;
+		for (int row = 0; row < 7; row++) {
+			// Runs of set bits are filled at once
+			int col = 0;
+			while (col < 5) {
+				if (!(gl->rows[row] & (0x10 >> col))) {
+					col++;
+					continue;
+				}
+				int end = col;
+				while (end < 5 && (gl->rows[row] & (0x10 >> end))) end++;
+				out(gx + col * px, top + row * px, gx + end * px, top + (row + 1) * px);
+				col = end;
+			}
+		}
+	}
+}
+
+static int text_r, text_g, text_b, text_a;
+
+static void textSpan(int x1, int y1, int x2, int y2) {
+	span(x1, y1, x2, y2, text_r, text_g, text_b, text_a);
+}
+
+static void rasterText(int font, int size, int x, int y, const char * s, int len, int r, int g, int b, int a) {
+	text_r = r;
+	text_g = g;
+	text_b = b;
+	text_a = a;
+	glyphSpans(size, x, y, s, len, textSpan);
+}
+
+static void rasterTextBounds(int font, int size, int x, int y, const char * s, int len, float * bounds) {
+	bounds[0] = x;
+	bounds[1] = y - size * 4 / 5;
+	bounds[2] = x + len * size * 3 / 5;
+	bounds[3] = y + size / 5;
+}
+
+// TEXT ATLAS
+// Prepared strings are kept as 1 byte coverage masks, drawing one is a single pass over its cell
+
+#define RASTER_ATLAS_W 1024
+#define RASTER_ATLAS_H 1024
+#define MAX_RASTER_RUNS 256
+
+struct RasterRun {
+	int ax, ay;		// cell in the atlas
+	int w, h;
+	int ox, oy;		// top left corner of the cell relative to the baseline origin
+};
+
+static unsigned char * atlas = NULL;
+static struct AtlasPacker packer;
+static struct RasterRun runs[MAX_RASTER_RUNS];
+static int cnt_runs = 0;
+static struct RasterRun * mask_run;
+
+static void maskSpan(int x1, int y1, int x2, int y2) {
+	for (int y = y1; y < y2; y++) {
+		unsigned char * p = atlas + (mask_run->ay + y) * RASTER_ATLAS_W + mask_run->ax;
+		memset(p + x1, 255, x2 - x1);
+	}
+}
+
+static int rasterPrepareText(int font, int size, const char * s, int len) {
+	if (cnt_runs == MAX_RASTER_RUNS || len == 0) return -1;
+	int px = size / 10;
+	if (px < 1) px = 1;
+
+	struct RasterRun * run = &runs[cnt_runs];
+	run->ox = 0;
+	run->oy = -7 * px;
+	run->w = (len - 1) * size * 3 / 5 + 5 * px;
+	run->h = 7 * px;
+	if (!atlasPack(&packer, run->w, run->h, &run->ax, &run->ay)) return -1;
+
+	// Spans are relative to the cell
+	mask_run = run;
+	glyphSpans(size, -run->ox, -run->oy, s, len, maskSpan);
+	return cnt_runs++;
+}
+
+static void rasterDrawPrepared(int handle, int x, int y, int r, int g, int b, int a) {
+	struct RasterRun * run = &runs[handle];
+	int x1 = x + run->ox, y1 = y + run->oy;
+	int x2 = x1 + run->w, y2 = y1 + run->h;
+	int sx = run->ax - x1, sy = run->ay - y1; // screen -> atlas
+	if (x1 < cx1) x1 = cx1;
+	if (y1 < cy1) y1 = cy1;
+	if (x2 > cx2) x2 = cx2;
+	if (y2 > cy2) y2 = cy2;
+	if (x1 >= x2 || y1 >= y2 || a == 0) return;
+
+	raster_stats.fills++;
+	uint32_t color = 0xff000000u | (r << 16) | (g << 8) | b;
+	for (int y = y1; y < y2; y++) {
+		uint32_t * p = raster_fb + y * fb_width;
+		const unsigned char * m = atlas + (y + sy) * RASTER_ATLAS_W + sx;
+		for (int x = x1; x < x2; x++) {
+			if (!m[x]) continue;
+			raster_stats.pixels++;
+			if (a == 255 && m[x] == 255) {
+				p[x] = color;
+				continue;
+			}
+			int ca = a * m[x] / 255;
+			uint32_t d = p[x];
+			int dr = (d >> 16) & 0xff, dg = (d >> 8) & 0xff, db = d & 0xff;
+			dr += (r - dr) * ca / 255;
+			dg += (g - dg) * ca / 255;
+			db += (b - db) * ca / 255;
+			p[x] = 0xff000000u | (dr << 16) | (dg << 8) | db;
+		}
+	}
+}
+// TEXT ATLAS
+
+// LAYERS
+
+#define MAX_RASTER_LAYERS 16
+
+static uint32_t * layers[MAX_RASTER_LAYERS];
+static int cnt_layers = 0;
+static uint32_t * screen_fb;
+
+static int rasterCreateLayer() {
+	if (cnt_layers == MAX_RASTER_LAYERS) return -1;
+	layers[cnt_layers] = (uint32_t *) malloc((size_t) fb_width * fb_height * sizeof(uint32_t));
+	if (layers[cnt_layers] == NULL) return -1;
+	return cnt_layers++;
+}
+
+static void rasterBeginLayer(int layer) {
+	screen_fb = raster_fb;
+	raster_fb = layers[layer];
+	for (int i = 0; i < fb_width * fb_height; i++) raster_fb[i] = 0xff000000u;
+	rasterResetClip();
+}
+
+static void rasterEndLayer() {
+	raster_fb = screen_fb;
+}
+
+static void rasterDrawLayer(int layer) {
+	if (cx1 >= cx2 || cy1 >= cy2) return;
+	raster_stats.fills++;
+	raster_stats.pixels += (long) (cx2 - cx1) * (cy2 - cy1);
+	for (int y = cy1; y < cy2; y++) {
+		memcpy(raster_fb + y * fb_width + cx1, layers[layer] + y * fb_width + cx1, (cx2 - cx1) * sizeof(uint32_t));
+	}
+}
+// LAYERS
+
+static struct RenderBackend render_raster = {
+	"raster", 0, 0,
+	rasterCreateFont,
+	rasterBeginFrame,
+	rasterEndFrame,
+	rasterClip,
+	rasterResetClip,
+	rasterFillRect,
+	rasterStrokeRect,
+	rasterText,
+	rasterTextBounds,
+	rasterPrepareText,
+	rasterDrawPrepared,
+	rasterCreateLayer,
+	rasterBeginLayer,
+	rasterEndLayer,
+	rasterDrawLayer
+};
+
+struct RenderBackend * renderRasterInit(int width, int height) {
+	fb_width = render_raster.width = width;
+	fb_height = render_raster.height = height;
+	raster_fb = (uint32_t *) calloc((size_t) width * height, sizeof(uint32_t));
+	atlas = (unsigned char *) calloc(RASTER_ATLAS_W * RASTER_ATLAS_H, 1);
+	if (raster_fb == NULL || atlas == NULL) return NULL;
+	atlasInit(&packer, RASTER_ATLAS_W, RASTER_ATLAS_H);
+	cnt_runs = 0;
+	memset(&raster_stats, 0, sizeof(raster_stats));
+	rasterResetClip();
+	return &render_raster;
+}
+
+void renderRasterClose() {
+	free(raster_fb);
+	free(atlas);
+	for (int i = 0; i < cnt_layers; i++) free(layers[i]);
+	cnt_layers = 0;
+	raster_fb = NULL;
+	atlas = NULL;
+}
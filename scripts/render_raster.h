@@ -0,0 +1,28 @@
+#ifndef RENDER_RASTER_H
+#define RENDER_RASTER_H
+
+#include <stdint.h>
+
+#include "render.h"
+
+// Pixels are 0xAARRGGBB
+extern uint32_t * raster_fb;
+
+struct RasterStats {
+	long pixels;	// pixels written
+	long fills;		// filled spans of rectangles and glyphs
+	long frames;
+};
+
+extern struct RasterStats raster_stats;
+
+/*
+	Software backend that draws into 'raster_fb' in memory, for running the UI without the TFT.
+	Text is drawn with a built-in 5x7 bitmap font scaled to the font size with the advance of
+	Courier New (0.6 em). It knows digits and the few symbols the UI uses, other characters
+	are drawn as boxes.
+*/
+struct RenderBackend * renderRasterInit(int width, int height);
+void renderRasterClose();
+
+#endif
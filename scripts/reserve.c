@@ -0,0 +1,505 @@
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "intmap.h"
+#include "reserve.h"
+#include "status.h"
+
+struct ReserveNode {
+	struct Reservation r;
+	long max_end;	// of the subtree
+	long max_lesson_end;	// of the subtree without the loans, LONG_MIN if there are only loans
+	unsigned int prio;
+	int left, right;	// indices in 'nodes', -1 if none
+};
+
+static struct ReserveNode * nodes = NULL;
+static int cnt_nodes = 0, cap_nodes = 0;
+static int free_node = -1;	// list of removed nodes through 'left'
+static int cnt_live = 0;
+
+// Root of the tree of every computer, next to c_status[]
+static int roots[MAX_COMP];
+static int roots_ready = 0;
+static struct IntMap by_id;	// id -> node
+static int next_id = 1;
+static long long version = 0;	// of the server's reservations
+
+static char journal_path[256];
+static FILE * journal = NULL;
+// Held while the journal file is written
+static pthread_mutex_t journal_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Lines of reserveAdd() and reserveRemove() wait here, so the UI doesn't wait for the fsync.
+// The writer thread appends and syncs them, like accesslog.c.
+static pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+static char * queued = NULL;
+static int queued_len = 0, queued_cap = 0;
+static int writer_running = 0;
+static pthread_t writer;
+static unsigned int seed = 12345;
+
+static unsigned int nextPrio() {
+	seed = seed * 1103515245 + 12345;
+	return seed;
+}
+
+static void initRoots() {
+	if (roots_ready) return;
+	for (int i = 0; i < MAX_COMP; i++) roots[i] = -1;
+	intMapInit(&by_id, 256);
+	roots_ready = 1;
+}
+
+// TREAP
+
+static void update(int n) {
+	struct ReserveNode * p = &nodes[n];
+	p->max_end = p->r.end;
+	p->max_lesson_end = p->r.kind == RESERVE_LOAN ? LONG_MIN : p->r.end;
+	for (int c = 0; c < 2; c++) {
+		int k = c ? p->right : p->left;
+		if (k < 0) continue;
+		if (nodes[k].max_end > p->max_end) p->max_end = nodes[k].max_end;
+		if (nodes[k].max_lesson_end > p->max_lesson_end) p->max_lesson_end = nodes[k].max_lesson_end;
+	}
+}
+
+static int before(struct Reservation * a, struct Reservation * b) {
+	return a->start < b->start || (a->start == b->start && a->id < b->id);
+}
+
+static int rotateRight(int n) {
+	int l = nodes[n].left;
+	nodes[n].left = nodes[l].right;
+	nodes[l].right = n;
+	update(n);
+	update(l);
+	return l;
+}
+
+static int rotateLeft(int n) {
+	int r = nodes[n].right;
+	nodes[n].right = nodes[r].left;
+	nodes[r].left = n;
+	update(n);
+	update(r);
+	return r;
+}
+
+static int insert(int root, int n) {
+	if (root < 0) return n;
+	if (before(&nodes[n].r, &nodes[root].r)) {
+		nodes[root].left = insert(nodes[root].left, n);
+		if (nodes[nodes[root].left].prio > nodes[root].prio) return rotateRight(root);
+	} else {
+		nodes[root].right = insert(nodes[root].right, n);
+		if (nodes[nodes[root].right].prio > nodes[root].prio) return rotateLeft(root);
+	}
+	update(root);
+	return root;
+}
+
+// Unlinks node 'n' from the tree 'root'
+static int erase(int root, int n) {
+	if (root < 0) return -1;
+	if (root == n) {
+		struct ReserveNode * p = &nodes[n];
+		if (p->left < 0) return p->right;
+		if (p->right < 0) return p->left;
+		if (nodes[p->left].prio > nodes[p->right].prio) {
+			root = rotateRight(n);
+			nodes[root].right = erase(nodes[root].right, n);
+		} else {
+			root = rotateLeft(n);
+			nodes[root].left = erase(nodes[root].left, n);
+		}
+	} else if (before(&nodes[n].r, &nodes[root].r)) {
+		nodes[root].left = erase(nodes[root].left, n);
+	} else {
+		nodes[root].right = erase(nodes[root].right, n);
+	}
+	update(root);
+	return root;
+}
+
+// The node with the earliest start among the ones that end after 'from', -1 if none
+static int firstEndingAfter(int root, long from) {
+	int n = root;
+	while (n >= 0 && nodes[n].max_end > from) {
+		int l = nodes[n].left;
+		if (l >= 0 && nodes[l].max_end > from) n = l;
+		else if (nodes[n].r.end > from) return n;
+		else n = nodes[n].right;
+	}
+	return -1;
+}
+
+// The same without the loans
+static int firstLessonEndingAfter(int root, long from) {
+	int n = root;
+	while (n >= 0 && nodes[n].max_lesson_end > from) {
+		int l = nodes[n].left;
+		if (l >= 0 && nodes[l].max_lesson_end > from) n = l;
+		else if (nodes[n].r.kind != RESERVE_LOAN && nodes[n].r.end > from) return n;
+		else n = nodes[n].right;
+	}
+	return -1;
+}
+// TREAP
+
+static int allocNode() {
+	if (free_node >= 0) {
+		int n = free_node;
+		free_node = nodes[n].left;
+		return n;
+	}
+	if (cnt_nodes == cap_nodes) {
+		cap_nodes = cap_nodes ? cap_nodes * 2 : 256;
+		nodes = (struct ReserveNode *) realloc(nodes, sizeof(struct ReserveNode) * cap_nodes);
+	}
+	return cnt_nodes++;
+}
+
+static int validComp(int comp) {
+	return comp >= 0 && comp < MAX_COMP;
+}
+
+static void addNode(struct Reservation * r) {
+	int n = allocNode();
+	nodes[n].r = *r;
+	nodes[n].prio = nextPrio();
+	nodes[n].left = nodes[n].right = -1;
+	update(n);
+	roots[r->comp] = insert(roots[r->comp], n);
+	intMapPut(&by_id, r->id, n);
+	if (r->id >= next_id && r->id < RESERVE_SYNC_BASE) next_id = r->id + 1;
+	cnt_live++;
+}
+
+static int removeNode(int id) {
+	int n = intMapGet(&by_id, id, -1);
+	if (n < 0) return -1;
+	int comp = nodes[n].r.comp;
+	roots[comp] = erase(roots[comp], n);
+	intMapPut(&by_id, id, -1);
+	nodes[n].left = free_node;
+	free_node = n;
+	cnt_live--;
+	return 0;
+}
+
+static void removeSynced() {
+	for (int n = 0; n < cnt_nodes; n++) {
+		int id = nodes[n].r.id;
+		if (id >= RESERVE_SYNC_BASE && intMapGet(&by_id, id, -1) == n) removeNode(id);
+	}
+}
+
+static int validReservation(const struct Reservation * r) {
+	return validComp(r->comp) && r->start < r->end;
+}
+
+// JOURNAL
+
+static void writeRecord(FILE * f, struct Reservation * r) {
+	fprintf(f, "+ %i %i %ld %ld %i\n", r->id, r->comp, r->start, r->end, r->kind);
+}
+
+static void flushJournal(FILE * f) {
+	fflush(f);
+	fsync(fileno(f));
+}
+
+// Changes of the server read from the journal, applied at the next "v" line
+struct Staged {
+	char op;	// '+', '-' or '*'
+	struct Reservation r;
+};
+
+static struct Staged * staged = NULL;
+static int cnt_staged = 0, cap_staged = 0;
+
+static void stage(char op, struct Reservation * r) {
+	if (cnt_staged == cap_staged) {
+		cap_staged = cap_staged ? cap_staged * 2 : 256;
+		staged = (struct Staged *) realloc(staged, sizeof(struct Staged) * cap_staged);
+	}
+	staged[cnt_staged].op = op;
+	staged[cnt_staged].r = *r;
+	cnt_staged++;
+}
+
+static void commitStaged() {
+	for (int i = 0; i < cnt_staged; i++) {
+		struct Reservation * r = &staged[i].r;
+		if (staged[i].op == '*') removeSynced();
+		else if (staged[i].op == '-') removeNode(r->id);
+		else {
+			removeNode(r->id);
+			addNode(r);
+		}
+	}
+	cnt_staged = 0;
+}
+
+static void replay(const char * path) {
+	FILE * f = fopen(path, "r");
+	if (f == NULL) return;
+	char line[256];
+	while (fgets(line, sizeof(line), f)) {
+		struct Reservation r;
+		long long v;
+		if (line[0] == '+' && sscanf(line + 1, "%i %i %ld %ld %i", &r.id, &r.comp, &r.start, &r.end, &r.kind) == 5) {
+			if (!validReservation(&r)) continue;
+			if (r.id >= RESERVE_SYNC_BASE) stage('+', &r);
+			else if (intMapGet(&by_id, r.id, -1) < 0) addNode(&r);
+		} else if (line[0] == '-' && sscanf(line + 1, "%i", &r.id) == 1) {
+			if (r.id >= RESERVE_SYNC_BASE) stage('-', &r);
+			else removeNode(r.id);
+		} else if (line[0] == '*') {
+			stage('*', &r);
+		} else if (line[0] == 'v' && sscanf(line + 1, "%lld", &v) == 1) {
+			commitStaged();
+			version = v;
+		}
+	}
+	// A change of the server that wasn't written completely, it is pulled again
+	cnt_staged = 0;
+	fclose(f);
+}
+
+// Writes the live reservations that end after 'keep' to a new journal
+static int compact(const char * path, long keep) {
+	char tmp[300];
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	FILE * f = fopen(tmp, "w");
+	if (f == NULL) {
+		perror(tmp);
+		return -1;
+	}
+	fprintf(f, "# Reservations, appended by the program. Lines:\n");
+	fprintf(f, "# + <id> <gui id> <start> <end> <kind: 0 - lesson, 1 - loan>, unix time\n");
+	fprintf(f, "# - <id>\n");
+	fprintf(f, "# * (drop the server's), v <server version>: the server's changes before it count\n");
+	for (int n = 0; n < cnt_nodes; n++) {
+		struct Reservation * r = &nodes[n].r;
+		if (intMapGet(&by_id, r->id, -1) != n) continue;
+		if (r->end < keep) {
+			removeNode(r->id);
+			continue;
+		}
+		writeRecord(f, r);
+	}
+	fprintf(f, "v %lld\n", version);
+	flushJournal(f);
+	fclose(f);
+	if (rename(tmp, path) != 0) {
+		perror(path);
+		return -1;
+	}
+	return 0;
+}
+
+static void queueLine(const char * line) {
+	int len = strlen(line);
+	pthread_mutex_lock(&queue_lock);
+	if (queued_len + len > queued_cap) {
+		queued_cap = queued_cap ? queued_cap * 2 : 4096;
+		while (queued_len + len > queued_cap) queued_cap *= 2;
+		queued = (char *) realloc(queued, queued_cap);
+	}
+	memcpy(queued + queued_len, line, len);
+	queued_len += len;
+	pthread_cond_signal(&queue_cond);
+	pthread_mutex_unlock(&queue_lock);
+}
+
+static void * writeQueued(void * arg) {
+	pthread_mutex_lock(&queue_lock);
+	while (1) {
+		while (queued_len == 0 && writer_running) pthread_cond_wait(&queue_cond, &queue_lock);
+		if (queued_len == 0) break;
+		// Everything queued so far goes out with one fsync
+		char * buf = queued;
+		int len = queued_len;
+		queued = NULL;
+		queued_len = queued_cap = 0;
+		pthread_mutex_unlock(&queue_lock);
+
+		pthread_mutex_lock(&journal_lock);
+		if (fwrite(buf, 1, len, journal) != (size_t) len) perror(journal_path);
+		flushJournal(journal);
+		pthread_mutex_unlock(&journal_lock);
+		free(buf);
+		pthread_mutex_lock(&queue_lock);
+	}
+	pthread_mutex_unlock(&queue_lock);
+	return NULL;
+}
+// JOURNAL
+
+int reserveInit(const char * path) {
+	initRoots();
+	snprintf(journal_path, sizeof(journal_path), "%s", path);
+
+	long start = monotonicUs();
+	replay(path);
+	if (compact(path, time(NULL) - RESERVE_KEEP_S) != 0) return -1;
+	journal = fopen(path, "a");
+	if (journal == NULL) {
+		perror(path);
+		return -1;
+	}
+	writer_running = 1;
+	if (pthread_create(&writer, NULL, writeQueued, NULL) != 0) {
+		perror("pthread_create");
+		writer_running = 0;
+		fclose(journal);
+		journal = NULL;
+		return -1;
+	}
+	printf("reservations: %i loaded in %li us\n", cnt_live, monotonicUs() - start);
+	return 0;
+}
+
+int reserveAdd(int comp, long start, long end, int kind) {
+	initRoots();
+	if (!validComp(comp) || start >= end) return -1;
+	struct Reservation r;
+	r.id = next_id;
+	r.comp = comp;
+	r.kind = kind;
+	r.start = start;
+	r.end = end;
+	addNode(&r);
+	if (journal) {
+		char line[128];
+		snprintf(line, sizeof(line), "+ %i %i %ld %ld %i\n", r.id, r.comp, r.start, r.end, r.kind);
+		queueLine(line);
+	}
+	return r.id;
+}
+
+int reserveRemove(int id) {
+	initRoots();
+	if (removeNode(id) != 0) return -1;
+	if (journal) {
+		char line[32];
+		snprintf(line, sizeof(line), "- %i\n", id);
+		queueLine(line);
+	}
+	return 0;
+}
+
+// Doesn't touch the trees, so the sync thread calls it without uiLock
+void reserveJournalApply(int reset, const struct Reservation * adds, int cnt_adds, const int * removes,
+	int cnt_removes, long long v) {
+	if (journal == NULL) return;
+	pthread_mutex_lock(&journal_lock);
+	if (reset) fprintf(journal, "*\n");
+	for (int i = 0; i < cnt_removes; i++) fprintf(journal, "- %i\n", RESERVE_SYNC_BASE + removes[i]);
+	for (int i = 0; i < cnt_adds; i++) {
+		struct Reservation r = adds[i];
+		r.id += RESERVE_SYNC_BASE;
+		// Skipped like in reserveApply()
+		if (validReservation(&r)) writeRecord(journal, &r);
+	}
+	fprintf(journal, "v %lld\n", v);
+	flushJournal(journal);
+	pthread_mutex_unlock(&journal_lock);
+}
+
+void reserveApply(int reset, const struct Reservation * adds, int cnt_adds, const int * removes, int cnt_removes,
+	long long v) {
+	initRoots();
+	if (reset) removeSynced();
+	for (int i = 0; i < cnt_removes; i++) removeNode(RESERVE_SYNC_BASE + removes[i]);
+	for (int i = 0; i < cnt_adds; i++) {
+		struct Reservation r = adds[i];
+		r.id += RESERVE_SYNC_BASE;
+		// A broken update leaves the reservation as it was
+		if (!validReservation(&r)) continue;
+		removeNode(r.id);
+		addNode(&r);
+	}
+	version = v;
+}
+
+long long reserveVersion() {
+	return version;
+}
+
+int reserveGet(int id, struct Reservation * r) {
+	if (!roots_ready) return -1;
+	int n = intMapGet(&by_id, id, -1);
+	if (n < 0) return -1;
+	if (r) *r = nodes[n].r;
+	return 0;
+}
+
+int reserveConflict(int comp, long start, long end, struct Reservation * r) {
+	if (!roots_ready || !validComp(comp)) return 0;
+	int n = firstEndingAfter(roots[comp], start);
+	if (n < 0 || nodes[n].r.start >= end) return 0;
+	if (r) *r = nodes[n].r;
+	return 1;
+}
+
+long reserveFreeUntil(int comp, long from) {
+	if (!roots_ready || !validComp(comp)) return LONG_MAX;
+	int n = firstEndingAfter(roots[comp], from);
+	if (n < 0) return LONG_MAX;
+	return nodes[n].r.start > from ? nodes[n].r.start : from;
+}
+
+long reserveLessonFreeUntil(int comp, long from) {
+	if (!roots_ready || !validComp(comp)) return LONG_MAX;
+	int n = firstLessonEndingAfter(roots[comp], from);
+	if (n < 0) return LONG_MAX;
+	return nodes[n].r.start > from ? nodes[n].r.start : from;
+}
+
+long reserveFirstFree(int comp, long from, long len) {
+	if (!roots_ready || !validComp(comp)) return from;
+	long t = from;
+	while (1) {
+		int n = firstEndingAfter(roots[comp], t);
+		if (n < 0 || nodes[n].r.start >= t + len) return t;
+		t = nodes[n].r.end;
+	}
+}
+
+int reserveCount() {
+	return cnt_live;
+}
+
+void reserveClose() {
+	// What is queued is written first
+	if (writer_running) {
+		pthread_mutex_lock(&queue_lock);
+		writer_running = 0;
+		pthread_cond_signal(&queue_cond);
+		pthread_mutex_unlock(&queue_lock);
+		pthread_join(writer, NULL);
+	}
+	if (journal) fclose(journal);
+	journal = NULL;
+	if (!roots_ready) return;
+	free(nodes);
+	nodes = NULL;
+	cnt_nodes = cap_nodes = cnt_live = 0;
+	free_node = -1;
+	intMapFree(&by_id);
+	free(staged);
+	staged = NULL;
+	cnt_staged = cap_staged = 0;
+	version = 0;
+	roots_ready = 0;
+}
@@ -0,0 +1,71 @@
+#ifndef RESERVE_H
+#define RESERVE_H
+
+#define RESERVE_JOURNAL "reservations.txt"
+// Reservations that ended this long ago are dropped when the journal is compacted
+#define RESERVE_KEEP_S (24 * 3600)
+
+#define RESERVE_LESSON 0	// made by an admin
+#define RESERVE_LOAN 1		// taken at the box, until the chosen return time
+
+// Reservations from the server (see reservesync.h) have this plus the server's id,
+// reserveAdd() never hands these out
+#define RESERVE_SYNC_BASE 1000000000
+
+// 'comp' is the GUI id, like in c_status[]. [start, end) in unix time.
+struct Reservation {
+	int id, comp, kind;
+	long start, end;
+};
+
+/*
+	Every computer has its own interval tree: a treap ordered by start, every node knows the
+	latest end in its subtree, with and without the loans. Conflicts and free slots are found
+	in O(log n).
+	Changes are appended to the journal ("+ id comp start end kind" / "- id") by a thread of
+	its own, so the caller doesn't wait for the fsync, and replayed on start.
+	Not thread-safe, the UI calls it under uiLock(), all but reserveJournalApply().
+	Changes from the server are followed by "v <version>", on replay they only count
+	once that line is there, "*" drops all of the server's reservations.
+*/
+
+// Replays the journal and compacts it. Returns -1 if it can't be written,
+// the reservations are only kept in memory then.
+int reserveInit(const char * path);
+
+// Doesn't check for conflicts, see reserveConflict(). Returns the id of the reservation.
+int reserveAdd(int comp, long start, long end, int kind);
+// Returns -1 if there is no such reservation
+int reserveRemove(int id);
+
+// Returns 1 and fills 'r' (can be NULL) with the earliest reservation of 'comp' overlapping [start, end)
+int reserveConflict(int comp, long start, long end, struct Reservation * r);
+// Until when 'comp' is free from 'from' on: 'from' if it is taken then, LONG_MAX if it is never taken.
+long reserveFreeUntil(int comp, long from);
+// The same, but loans don't count
+long reserveLessonFreeUntil(int comp, long from);
+// The earliest t >= from such that [t, t + len) is free
+long reserveFirstFree(int comp, long from, long len);
+
+/*
+	Applies a change of the server in one go: with 'reset' its reservations are dropped first,
+	then 'removes' (ids of the server) are removed and 'adds' (ids of the server) are added or
+	replaced. Only in memory, the change is journaled before with reserveJournalApply().
+*/
+void reserveApply(int reset, const struct Reservation * adds, int cnt_adds, const int * removes, int cnt_removes,
+	long long version);
+// Writes the same change to the journal with one fsync, together with 'version'. Doesn't
+// touch the reservations in memory, so it is called without uiLock. If the power goes before
+// reserveApply(), the change is applied on the next start.
+void reserveJournalApply(int reset, const struct Reservation * adds, int cnt_adds, const int * removes,
+	int cnt_removes, long long version);
+// The version of the last reserveApply(), 0 if none
+long long reserveVersion();
+// Returns -1 if there is no such reservation
+int reserveGet(int id, struct Reservation * r);
+
+int reserveCount();
+// Closes the journal and forgets the reservations
+void reserveClose();
+
+#endif
@@ -0,0 +1,163 @@
+/*
+	Books a semester of lessons for every computer, checks the interval trees of reserve.c
+	against a linear scan and prints the time per query and of replaying the journal.
+
+	./reservebench [computers] [weeks]
+*/
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "reserve.h"
+#include "status.h"
+
+#define JOURNAL "/tmp/reservebench.txt"
+#define QUERIES 100000
+
+struct Reservation * all;
+int cnt_all = 0;
+
+long linearFreeUntil(int comp, long from) {
+	long best = LONG_MAX;
+	for (int i = 0; i < cnt_all; i++) {
+		struct Reservation * r = &all[i];
+		if (r->comp != comp || r->end <= from) continue;
+		long s = r->start > from ? r->start : from;
+		if (s < best) best = s;
+	}
+	return best;
+}
+
+long linearLessonFreeUntil(int comp, long from) {
+	long best = LONG_MAX;
+	for (int i = 0; i < cnt_all; i++) {
+		struct Reservation * r = &all[i];
+		if (r->comp != comp || r->end <= from || r->kind == RESERVE_LOAN) continue;
+		long s = r->start > from ? r->start : from;
+		if (s < best) best = s;
+	}
+	return best;
+}
+
+long linearFirstFree(int comp, long from, long len) {
+	long t = from;
+	int moved = 1;
+	while (moved) {
+		moved = 0;
+		for (int i = 0; i < cnt_all; i++) {
+			struct Reservation * r = &all[i];
+			if (r->comp == comp && r->start < t + len && r->end > t) {
+				t = r->end;
+				moved = 1;
+			}
+		}
+	}
+	return t;
+}
+
+int main(int argc, char * argv[]) {
+	int comps = 37, weeks = 18;
+	if (argc > 1) comps = atoi(argv[1]);
+	if (argc > 2) weeks = atoi(argv[2]);
+	if (comps > MAX_COMP) comps = MAX_COMP;
+
+	// Starts next Monday 8:30, 7 lessons of 45 min with 10 min breaks, 5 days a week
+	long now = time(NULL);
+	long day0 = now - now % 86400 + 86400;
+	unlink(JOURNAL);
+	if (reserveInit(JOURNAL) != 0) return 1;
+
+	all = (struct Reservation *) malloc(sizeof(struct Reservation) * comps * weeks * (5 * 7 + 3));
+	srand(1);
+	long t = monotonicUs();
+	for (int c = 0; c < comps; c++) {
+		for (int d = 0; d < weeks * 7; d++) {
+			if (d % 7 >= 5) continue;
+			for (int l = 0; l < 7; l++) {
+				// Not every computer in every lesson
+				if (rand() % 4 == 0) continue;
+				struct Reservation * r = &all[cnt_all++];
+				r->comp = c;
+				r->start = day0 + d * 86400L + 8 * 3600 + 1800 + l * 55 * 60;
+				r->end = r->start + 45 * 60;
+				r->kind = RESERVE_LESSON;
+				r->id = reserveAdd(c, r->start, r->end, r->kind);
+			}
+		}
+	}
+	// Loans of 1 to 6 hours, three a week, lessons booked later can overlap them
+	for (int c = 0; c < comps; c++) {
+		for (int w = 0; w < weeks * 3; w++) {
+			struct Reservation * r = &all[cnt_all++];
+			r->comp = c;
+			r->start = day0 + rand() % (weeks * 7 * 86400L);
+			r->end = r->start + 3600 * (1 + rand() % 6);
+			r->kind = RESERVE_LOAN;
+			r->id = reserveAdd(c, r->start, r->end, r->kind);
+		}
+	}
+	t = monotonicUs() - t;
+	printf("%d reservations for %d computers, %.2f us per add (with the journal)\n",
+		cnt_all, comps, (double) t / cnt_all);
+
+	// Every tenth one is cancelled
+	for (int i = 0; i < cnt_all; i += 10) reserveRemove(all[i].id);
+	int j = 0;
+	for (int i = 0; i < cnt_all; i++) if (i % 10) all[j++] = all[i];
+	cnt_all = j;
+
+	long span = weeks * 7 * 86400L;
+	long * froms = (long *) malloc(sizeof(long) * QUERIES);
+	int * cs = (int *) malloc(sizeof(int) * QUERIES);
+	for (int i = 0; i < QUERIES; i++) {
+		froms[i] = day0 + rand() % span;
+		cs[i] = rand() % comps;
+	}
+
+	long sum = 0;
+	t = monotonicUs();
+	for (int i = 0; i < QUERIES; i++) sum += reserveFreeUntil(cs[i], froms[i]) % 1000;
+	long free_us = monotonicUs() - t;
+	t = monotonicUs();
+	for (int i = 0; i < QUERIES; i++) sum += reserveFirstFree(cs[i], froms[i], 3 * 3600) % 1000;
+	long slot_us = monotonicUs() - t;
+	t = monotonicUs();
+	for (int i = 0; i < QUERIES; i++) sum += reserveConflict(cs[i], froms[i], froms[i] + 3600, NULL);
+	long conflict_us = monotonicUs() - t;
+
+	int checked = 1000, mismatches = 0;
+	t = monotonicUs();
+	for (int i = 0; i < checked; i++) {
+		if (linearFreeUntil(cs[i], froms[i]) != reserveFreeUntil(cs[i], froms[i])) mismatches++;
+		if (linearFirstFree(cs[i], froms[i], 3 * 3600) != reserveFirstFree(cs[i], froms[i], 3 * 3600)) mismatches++;
+		if (linearLessonFreeUntil(cs[i], froms[i]) != reserveLessonFreeUntil(cs[i], froms[i])) mismatches++;
+	}
+	// A loan from 9:00 to 14:00 with a lesson from 10:00 to 11:00 in it, asked at 9:30
+	int c = comps < MAX_COMP ? comps : 0;
+	long day = day0 + 7 * 86400L;
+	int ids[2] = { reserveAdd(c, day + 9 * 3600, day + 14 * 3600, RESERVE_LOAN),
+		reserveAdd(c, day + 10 * 3600, day + 11 * 3600, RESERVE_LESSON) };
+	if (reserveLessonFreeUntil(c, day + 9 * 3600 + 1800) != day + 10 * 3600) mismatches++;
+	if (reserveFreeUntil(c, day + 9 * 3600 + 1800) != day + 9 * 3600 + 1800) mismatches++;
+	reserveRemove(ids[0]);
+	reserveRemove(ids[1]);
+	long linear_us = monotonicUs() - t;
+
+	printf("free until:  %.3f us/query\n", (double) free_us / QUERIES);
+	printf("first free:  %.3f us/query (3 h slot)\n", (double) slot_us / QUERIES);
+	printf("conflict:    %.3f us/query\n", (double) conflict_us / QUERIES);
+	printf("linear scan: %.1f us/query pair, %d mismatches in %d (checksum %ld)\n",
+		(double) linear_us / checked, mismatches, checked, sum);
+
+	// Replay as on start, the journal has the cancellations too
+	reserveClose();
+	t = monotonicUs();
+	reserveInit(JOURNAL);
+	t = monotonicUs() - t;
+	printf("journal replay: %d reservations in %.1f ms\n", reserveCount(), t / 1000.0);
+	reserveClose();
+	unlink(JOURNAL);
+	return mismatches != 0;
+}
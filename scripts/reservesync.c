@@ -0,0 +1,220 @@
+#include <netdb.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "reservesync.h"
+#include "status.h"
+
+#define IO_TIMEOUT_S 5
+
+struct ReserveSyncStats reserve_sync_stats;
+
+static char host[128], port[16];
+static unsigned int kiosk = 0;
+static int every_s = RESERVE_SYNC_EVERY_S;
+static void (*lock)() = NULL;
+static void (*unlock)() = NULL;
+static void (*changed)() = NULL;
+static volatile int running = 0;
+static pthread_t thread;
+
+// DELTA
+
+static void addAdd(struct ReserveDelta * d, struct Reservation * r) {
+	if (d->cnt_adds == d->cap_adds) {
+		d->cap_adds = d->cap_adds ? d->cap_adds * 2 : 64;
+		d->adds = (struct Reservation *) realloc(d->adds, sizeof(struct Reservation) * d->cap_adds);
+	}
+	d->adds[d->cnt_adds++] = *r;
+}
+
+static void addRemove(struct ReserveDelta * d, int id) {
+	if (d->cnt_removes == d->cap_removes) {
+		d->cap_removes = d->cap_removes ? d->cap_removes * 2 : 64;
+		d->removes = (int *) realloc(d->removes, sizeof(int) * d->cap_removes);
+	}
+	d->removes[d->cnt_removes++] = id;
+}
+
+void reserveDeltaFree(struct ReserveDelta * d) {
+	free(d->adds);
+	free(d->removes);
+	memset(d, 0, sizeof(*d));
+}
+
+static int validId(int id) {
+	return id >= 0 && id < RESERVE_SYNC_MAX_ID;
+}
+
+// Blocking, every read and write gives up after IO_TIMEOUT_S
+static int connectServer() {
+	struct addrinfo hints, * res;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host, port, &hints, &res) != 0) return -1;
+	int fd = socket(res->ai_family, res->ai_socktype | SOCK_CLOEXEC, res->ai_protocol);
+	if (fd >= 0) {
+		struct timeval tv = { IO_TIMEOUT_S, 0 };
+		setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+		setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+		if (connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+			close(fd);
+			fd = -1;
+		}
+	}
+	freeaddrinfo(res);
+	return fd;
+}
+
+int reserveSyncFetch(long long version, struct ReserveDelta * d) {
+	memset(d, 0, sizeof(*d));
+	int fd = connectServer();
+	if (fd < 0) return -1;
+	char line[256];
+	int len = snprintf(line, sizeof(line), "delta %u %lld\n", kiosk, version);
+	if (send(fd, line, len, MSG_NOSIGNAL) != len) {
+		close(fd);
+		return -1;
+	}
+
+	FILE * f = fdopen(fd, "r");
+	if (f == NULL) {
+		close(fd);
+		return -1;
+	}
+	int done = 0, bad = 0;
+	while (!done && !bad && fgets(line, sizeof(line), f)) {
+		d->bytes += strlen(line);
+		struct Reservation r;
+		if (line[0] == '+') {
+			// Only lessons come from the server, loans are taken at the box
+			bad = sscanf(line + 1, "%i %i %ld %ld %i", &r.id, &r.comp, &r.start, &r.end, &r.kind) != 5 || !validId(r.id)
+				|| r.kind != RESERVE_LESSON;
+			if (!bad) addAdd(d, &r);
+		} else if (line[0] == '-') {
+			bad = sscanf(line + 1, "%i", &r.id) != 1 || !validId(r.id);
+			if (!bad) addRemove(d, r.id);
+		} else if (line[0] == '*') {
+			d->reset = 1;
+		} else if (line[0] == 'v') {
+			bad = sscanf(line + 1, "%lld", &d->version) != 1;
+			done = 1;
+		} else {
+			bad = 1;
+		}
+	}
+	fclose(f);
+	// Without the version line the answer was cut off, nothing of it is used
+	if (!done || bad) {
+		reserveDeltaFree(d);
+		return -1;
+	}
+	return 0;
+}
+// DELTA
+
+int reserveSyncPull() {
+	struct ReserveSyncStats * s = &reserve_sync_stats;
+	long start = monotonicUs();
+	lock();
+	long long version = reserveVersion();
+	unlock();
+
+	struct ReserveDelta d;
+	s->pulls++;
+	if (reserveSyncFetch(version, &d) != 0) {
+		s->failures++;
+		return -1;
+	}
+	int change = d.reset || d.cnt_adds > 0 || d.cnt_removes > 0 || d.version != version;
+	if (change) {
+		// The fsync happens before the UI is held up
+		reserveJournalApply(d.reset, d.adds, d.cnt_adds, d.removes, d.cnt_removes, d.version);
+		lock();
+		reserveApply(d.reset, d.adds, d.cnt_adds, d.removes, d.cnt_removes, d.version);
+		unlock();
+		if (changed) changed();
+	} else {
+		s->empty++;
+	}
+
+	s->resets += d.reset;
+	s->adds += d.cnt_adds;
+	s->removes += d.cnt_removes;
+	s->bytes += d.bytes;
+	s->version = d.version;
+	s->last_ok = time(NULL);
+	s->last_pull_us = monotonicUs() - start;
+	if (s->last_pull_us > s->max_pull_us) s->max_pull_us = s->last_pull_us;
+	reserveDeltaFree(&d);
+	return 0;
+}
+
+static void * puller(void * arg) {
+	int wait_s = every_s;
+	while (running) {
+		if (reserveSyncPull() == 0) {
+			wait_s = every_s;
+		} else {
+			// The replica keeps answering meanwhile
+			wait_s = wait_s * 2 > RESERVE_SYNC_RETRY_MAX_S ? RESERVE_SYNC_RETRY_MAX_S : wait_s * 2;
+		}
+		for (long end = monotonicUs() + wait_s * 1000000L; running && monotonicUs() < end; ) usleep(100000);
+	}
+	return NULL;
+}
+
+int reserveSyncInit(const char * config, void (*lock_fn)(), void (*unlock_fn)(), void (*changed_fn)()) {
+	FILE * f = fopen(config, "r");
+	if (f == NULL) {
+		fprintf(stderr, "No %s, only the reservations made here are known\n", config);
+		return -1;
+	}
+	char line[256];
+	int ok = 0;
+	while (fgets(line, sizeof(line), f)) {
+		if (line[0] == '#') continue;
+		unsigned int k = 0;
+		int e = RESERVE_SYNC_EVERY_S;
+		if (sscanf(line, "%127s %15s %u %i", host, port, &k, &e) >= 2) {
+			kiosk = k;
+			every_s = e > 0 ? e : RESERVE_SYNC_EVERY_S;
+			ok = 1;
+			break;
+		}
+	}
+	fclose(f);
+	if (!ok) return -1;
+
+	lock = lock_fn;
+	unlock = unlock_fn;
+	changed = changed_fn;
+	running = 1;
+	if (pthread_create(&thread, NULL, puller, NULL) != 0) {
+		perror("pthread_create");
+		running = 0;
+		return -1;
+	}
+	return 0;
+}
+
+void reserveSyncPrintStats(FILE * f) {
+	struct ReserveSyncStats * s = &reserve_sync_stats;
+	fprintf(f, "reservation sync: version %lld, %ld pulls, %ld failed, %ld with nothing new, %ld full, last ok %lds ago\n",
+		s->version, s->pulls, s->failures, s->empty, s->resets, s->last_ok ? (long) time(NULL) - s->last_ok : -1L);
+	fprintf(f, "reservation sync: %ld added, %ld removed, %ld bytes, pull took %ld us (max %ld us)\n",
+		s->adds, s->removes, s->bytes, s->last_pull_us, s->max_pull_us);
+}
+
+void reserveSyncClose() {
+	if (!running) return;
+	running = 0;
+	pthread_join(thread, NULL);
+}
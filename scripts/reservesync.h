@@ -0,0 +1,61 @@
+#ifndef RESERVESYNC_H
+#define RESERVESYNC_H
+
+#include <stdio.h>
+
+#include "reserve.h"
+
+#define RESERVE_SYNC_FILE "reservesync.txt"
+#define RESERVE_SYNC_EVERY_S 30
+#define RESERVE_SYNC_RETRY_MAX_S 300
+// Ids of the server must stay below this, see RESERVE_SYNC_BASE
+#define RESERVE_SYNC_MAX_ID 1000000000
+
+/*
+	The server owns the lessons, reserve.c keeps a replica of them in its journal, so the
+	box decides on its own and keeps doing so while the server is away.
+	Every pull asks only for what changed since the version of the replica:
+
+	client: "delta <kiosk id> <version>\n"
+	server: "*\n" if the version is unknown to it and it sends everything instead,
+	        "+ <id> <gui id> <start> <end> <kind>\n" added or changed, kind is always
+	        RESERVE_LESSON, anything else breaks the answer,
+	        "- <id>\n" removed,
+	        "v <version>\n" last, the change counts only with it.
+	Then the server closes the connection.
+*/
+struct ReserveDelta {
+	int reset;
+	struct Reservation * adds;
+	int cnt_adds, cap_adds;
+	int * removes;
+	int cnt_removes, cap_removes;
+	long long version;
+	long bytes;
+};
+
+struct ReserveSyncStats {
+	long pulls, failures, resets, empty;	// empty: nothing changed
+	long adds, removes, bytes;
+	long last_pull_us, max_pull_us;
+	long last_ok;		// unix time of the last pull that worked
+	long long version;
+};
+
+extern struct ReserveSyncStats reserve_sync_stats;
+
+/*
+	reservesync.txt: "<host> <port> [<kiosk id> [<seconds between pulls>]]", off without it.
+	'lock' and 'unlock' guard reserve.c, 'changed' (can be NULL) is called after a change
+	with the lock released.
+*/
+int reserveSyncInit(const char * config, void (*lock)(), void (*unlock)(), void (*changed)());
+// Pulls once now, returns -1 if the server can't be reached or the answer is broken
+int reserveSyncPull();
+// Asks the server for the changes since 'version', 0 for all of them
+int reserveSyncFetch(long long version, struct ReserveDelta * d);
+void reserveDeltaFree(struct ReserveDelta * d);
+void reserveSyncPrintStats(FILE * f);
+void reserveSyncClose();
+
+#endif
@@ -0,0 +1,151 @@
+/*
+	Syncs reserve.c with reservesyncd.c on this machine: a while with changes on the server,
+	a while with the server down, then a restarted server, a few of its answers cut off.
+	After each phase the replica is compared with everything the server has, and at the end
+	with what the journal replays to.
+
+	./reservesyncbench [reservations] [changes per s]
+*/
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "reserve.h"
+#include "reservesync.h"
+#include "status.h"
+
+#define PORT "7081"
+#define CONFIG "/tmp/reservesyncbench.txt"
+#define JOURNAL "/tmp/reservesyncbench-journal.txt"
+#define CHURN_S "3"
+
+pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+void lockReserve() { pthread_mutex_lock(&lock); }
+void unlockReserve() { pthread_mutex_unlock(&lock); }
+
+pid_t startServer(const char * initial, const char * per_s, const char * cut, const char * seed) {
+	fflush(stdout);
+	pid_t pid = fork();
+	if (pid == 0) {
+		freopen("/dev/null", "w", stdout);
+		execl("./reservesyncd", "reservesyncd", PORT, initial, per_s, CHURN_S, cut, seed, (char *) NULL);
+		perror("./reservesyncd");
+		_exit(1);
+	}
+	usleep(200000);
+	return pid;
+}
+
+void stopServer(pid_t pid) {
+	kill(pid, SIGTERM);
+	waitpid(pid, NULL, 0);
+}
+
+// Returns the number of differences between the replica and the server
+int compare(const char * when) {
+	struct ReserveDelta all;
+	// The server may cut this one off too
+	int tries = 0;
+	while (reserveSyncFetch(0, &all) != 0 && ++tries < 3) {}
+	if (tries == 3) {
+		printf("%s: the server doesn't answer\n", when);
+		return 1;
+	}
+	lockReserve();
+	int bad = 0;
+	for (int i = 0; i < all.cnt_adds; i++) {
+		struct Reservation * a = &all.adds[i], r;
+		if (reserveGet(RESERVE_SYNC_BASE + a->id, &r) != 0 || r.comp != a->comp || r.start != a->start ||
+			r.end != a->end || r.kind != a->kind) bad++;
+	}
+	if (reserveCount() != all.cnt_adds) bad++;
+	printf("%s: %i reservations, version %lld, %i different, %ld bytes for everything\n", when,
+		reserveCount(), reserveVersion(), bad, all.bytes);
+	unlockReserve();
+	reserveDeltaFree(&all);
+	return bad;
+}
+
+// Pulls until a pull brings nothing new
+void settle() {
+	long empty = reserve_sync_stats.empty;
+	for (int i = 0; i < 100 && reserve_sync_stats.empty == empty; i++) reserveSyncPull();
+}
+
+int main(int argc, char * argv[]) {
+	const char * initial = argc > 1 ? argv[1] : "5000";
+	const char * per_s = argc > 2 ? argv[2] : "200";
+	int bad = 0;
+
+	unlink(JOURNAL);
+	FILE * f = fopen(CONFIG, "w");
+	fprintf(f, "127.0.0.1 %s 7 1\n", PORT);
+	fclose(f);
+	reserveInit(JOURNAL);
+
+	pid_t server = startServer(initial, per_s, "0", "1");
+	if (reserveSyncInit(CONFIG, lockReserve, unlockReserve, NULL) != 0) return 1;
+	long t = monotonicUs();
+	while (reserve_sync_stats.last_ok == 0) usleep(10000);
+	long first_bytes = reserve_sync_stats.bytes;
+	sleep(atoi(CHURN_S) + 1);
+	reserveSyncClose();
+	long delta_pulls = reserve_sync_stats.pulls - 1;
+	long delta_bytes = reserve_sync_stats.bytes - first_bytes;
+	settle();
+	bad += compare("changing server");
+	printf("first pull %ld bytes, then %ld pulls of %.0f bytes on average, pull took %ld us, max %ld us\n",
+		first_bytes, delta_pulls, (double) delta_bytes / (delta_pulls ? delta_pulls : 1),
+		reserve_sync_stats.last_pull_us, reserve_sync_stats.max_pull_us);
+
+	// The replica keeps answering without the server
+	stopServer(server);
+	lockReserve();
+	int before = reserveCount();
+	unlockReserve();
+	long failures = reserve_sync_stats.failures;
+	int pulled = reserveSyncPull();
+	lockReserve();
+	long free_until = reserveFreeUntil(0, time(NULL));
+	printf("server down: pull %s, %i reservations still there, computer 0 free until %ld\n",
+		pulled == 0 ? "worked?" : "failed", reserveCount(), free_until);
+	if (pulled == 0 || reserveCount() != before || reserve_sync_stats.failures != failures + 1) bad++;
+	unlockReserve();
+
+	// Another server: everything again, some of the answers break off
+	server = startServer(initial, per_s, "3", "2");
+	long resets = reserve_sync_stats.resets;
+	failures = reserve_sync_stats.failures;
+	for (int i = 0; i < 20; i++) {
+		reserveSyncPull();
+		usleep(100000);
+	}
+	sleep(atoi(CHURN_S));
+	settle();
+	printf("restarted server, every 3rd answer cut: %ld full pulls, %ld failed\n",
+		reserve_sync_stats.resets - resets, reserve_sync_stats.failures - failures);
+	bad += compare("after the restart");
+
+	// The journal gives the same replica
+	lockReserve();
+	long long version = reserveVersion();
+	int cnt = reserveCount();
+	reserveClose();
+	long replay = monotonicUs();
+	reserveInit(JOURNAL);
+	replay = monotonicUs() - replay;
+	printf("journal: %i reservations at version %lld after replaying it in %ld us, before %i at %lld\n",
+		reserveCount(), reserveVersion(), replay, cnt, version);
+	if (reserveCount() != cnt || reserveVersion() != version) bad++;
+	unlockReserve();
+	bad += compare("replayed");
+
+	stopServer(server);
+	reserveSyncPrintStats(stdout);
+	printf("%.1f s, %s\n", (monotonicUs() - t) / 1e6, bad ? "FAILED" : "OK");
+	return bad ? 1 : 0;
+}
@@ -0,0 +1,168 @@
+/*
+	Stand-in for the reservation server of reservesync.c. It makes up lessons for the first
+	64 computers and keeps changing them: adds, moves and removes 'changes' per second for
+	'churn s' seconds. The versions of a restarted server start above the old ones and its
+	change log doesn't reach back to them, so its clients get everything again.
+
+	./reservesyncd [port] [reservations] [changes per s] [churn s] [cut every] [seed]
+
+	'cut every' N > 0 stops every Nth answer halfway, before its version line.
+*/
+#include <poll.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "reserve.h"
+#include "status.h"
+
+#define COMPUTERS 64
+#define LOG_MAX 4096
+
+struct Change {
+	long long version;
+	int id;
+};
+
+struct Reservation * res;	// by id, end == 0 if removed
+int cnt_res = 0, live = 0;
+struct Change changes[LOG_MAX];
+int cnt_changes = 0;	// the last LOG_MAX are kept
+long long version;
+int * sent;	// last answer an id was sent in
+int answers = 0;
+
+void logChange(int id) {
+	version++;
+	changes[cnt_changes % LOG_MAX].version = version;
+	changes[cnt_changes % LOG_MAX].id = id;
+	cnt_changes++;
+}
+
+// A lesson of one to three hours in the next two weeks
+void makeLesson(struct Reservation * r) {
+	long day = time(NULL) / 86400 * 86400;
+	r->comp = rand() % COMPUTERS;
+	r->kind = RESERVE_LESSON;
+	r->start = day + (rand() % 14) * 86400 + (8 + rand() % 10) * 3600 + (rand() % 4) * 900;
+	r->end = r->start + (1 + rand() % 3) * 3600;
+}
+
+void addLesson() {
+	res = (struct Reservation *) realloc(res, sizeof(struct Reservation) * (cnt_res + 1));
+	sent = (int *) realloc(sent, sizeof(int) * (cnt_res + 1));
+	struct Reservation * r = &res[cnt_res];
+	r->id = cnt_res;
+	makeLesson(r);
+	sent[cnt_res] = -1;
+	cnt_res++;
+	live++;
+	logChange(r->id);
+}
+
+void change() {
+	int id = rand() % cnt_res;
+	int what = rand() % 3;
+	if (what == 0 || live < 10) {
+		addLesson();
+	} else if (res[id].end == 0) {
+		return;
+	} else if (what == 1) {
+		makeLesson(&res[id]);
+		logChange(id);
+	} else {
+		res[id].end = 0;
+		live--;
+		logChange(id);
+	}
+}
+
+void sendLine(FILE * f, struct Reservation * r) {
+	if (r->end) fprintf(f, "+ %i %i %ld %ld %i\n", r->id, r->comp, r->start, r->end, r->kind);
+	else fprintf(f, "- %i\n", r->id);
+}
+
+void answer(int fd, int cut) {
+	char line[128];
+	int n = recv(fd, line, sizeof(line) - 1, 0);
+	if (n <= 0) return;
+	line[n] = 0;
+	unsigned int kiosk;
+	long long since;
+	if (sscanf(line, "delta %u %lld", &kiosk, &since) != 2) return;
+
+	FILE * f = fdopen(dup(fd), "w");
+	long long oldest = cnt_changes > LOG_MAX ? changes[cnt_changes % LOG_MAX].version : version - cnt_changes + 1;
+	int cnt = 0;
+	answers++;
+	if (since > version || since < oldest - 1) {
+		// Everything
+		fprintf(f, "*\n");
+		for (int id = 0; id < cnt_res; id++) {
+			if (res[id].end == 0) continue;
+			if (cut && ++cnt > live / 2) break;
+			sendLine(f, &res[id]);
+		}
+	} else {
+		// The last state of what changed since then, newest first
+		for (int i = cnt_changes - 1; i >= 0 && i >= cnt_changes - LOG_MAX; i--) {
+			struct Change * c = &changes[i % LOG_MAX];
+			if (c->version <= since) break;
+			if (sent[c->id] == answers) continue;
+			sent[c->id] = answers;
+			if (cut && ++cnt % 2 == 0) break;
+			sendLine(f, &res[c->id]);
+		}
+	}
+	if (!cut) fprintf(f, "v %lld\n", version);
+	fclose(f);
+}
+
+int main(int argc, char * argv[]) {
+	int port = argc > 1 ? atoi(argv[1]) : 7080;
+	int initial = argc > 2 ? atoi(argv[2]) : 2000;
+	double per_s = argc > 3 ? atof(argv[3]) : 1;
+	double churn_s = argc > 4 ? atof(argv[4]) : 1e9;
+	int cut_every = argc > 5 ? atoi(argv[5]) : 0;
+	srand(argc > 6 ? atoi(argv[6]) : time(NULL));
+
+	version = (long long) time(NULL) * 1000000;
+	for (int i = 0; i < initial; i++) addLesson();
+
+	int s = socket(AF_INET, SOCK_STREAM, 0);
+	int one = 1;
+	setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	if (bind(s, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(s, 8) != 0) {
+		perror("reservesyncd");
+		return 1;
+	}
+	printf("listening on %d, %d reservations, version %lld\n", port, live, version);
+	fflush(stdout);
+
+	long start = monotonicUs();
+	double done = 0;
+	int requests = 0;
+	while (1) {
+		// Catch up with the changes that are due
+		double t = (monotonicUs() - start) / 1e6;
+		double due = per_s * (t < churn_s ? t : churn_s);
+		for (; done + 1 <= due; done++) change();
+
+		struct pollfd p = { s, POLLIN, 0 };
+		if (poll(&p, 1, 10) <= 0) continue;
+		int fd = accept(s, NULL, NULL);
+		if (fd < 0) continue;
+		requests++;
+		answer(fd, cut_every > 0 && requests % cut_every == 0);
+		close(fd);
+	}
+}
@@ -0,0 +1,657 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "accesslog.h"
+#include "layout_gen.h"
+#include "reserve.h"
+#include "scenes.h"
+#include "status.h"
+#include "trace.h"
+#include "ui.h"
+
+int current_computer = 0;
+
+// TIME
+struct Object timeTextObj;
+struct Text* timeText;
+
+void setTime(int hour, int min) {
+	char ts[6];
+	ts[5] = 0;
+	ts[0] = '0' + hour / 10 % 10;
+	ts[1] = '0' + hour % 10;
+	ts[2] = ':';
+	ts[3] = '0' + min / 10 % 10;
+	ts[4] = '0' + min % 10;
+
+	if (strcmp(timeText->s, ts) == 0) return;
+	clearText(timeText);
+	addString(timeText, ts);
+}
+
+void updateTime() {
+	time_t rawtime;
+    struct tm * timeinfo;
+
+    time ( &rawtime );
+    timeinfo = localtime ( &rawtime );
+	setTime(timeinfo->tm_hour, timeinfo->tm_min);
+}
+
+void updateTimeTextColorAndPos() {
+	int col = 0;
+	if (current_scene == 2 || current_scene == 3 || current_scene == RESERVED_SCENE) {
+		col = 255;
+	}
+	timeText->r = col;
+	timeText->g = col;
+	timeText->b = col;
+	timeText->a = 255;
+	markDirty(&timeTextObj);
+
+////	if (current_scene == 0) {
+	//			timeTextObj = addText(&timeTextObj, width - 100, 35, 0, 0, font, 32, 5);
+	//}
+}
+// TIME
+
+
+
+struct Object backgrounds[NUM_SCENES];
+struct Object touchMarker;
+struct Object bigLogo, smallLogo;
+struct Object passwdText, buttonL, buttonR;
+struct Object calibTarget;
+struct Text * calibText;
+struct Object returnText, returnEarlier, returnLater, returnOk;
+struct Text * returnTime, * returnLimit;
+struct Object reservedInfo;
+struct Text * reservedText;
+
+char passwd[LEN_PASSWD + 1];
+
+#if LAYOUT_ICONS > MAX_COMP
+#error "layout.txt has more icons than MAX_COMP"
+#endif
+#if LAYOUT_KEYS > MAX_BUTTONS
+#error "layout.txt has more keys than MAX_BUTTONS"
+#endif
+
+// Tiles of the current icon page, 'data' is the id of the icon shown (see showPage())
+struct Object computerIcon[LAYOUT_TILES];
+
+struct Object buttons[MAX_BUTTONS];
+
+struct Object backButton[NUM_SCENES];
+
+void updateColor(struct Object * object, int status) {
+	int r, g, b;
+	r = g = b = 0;
+	if (status == 0) {
+		r = g = b = 127;
+	} else if (status == 1) {
+		r = 240;
+		g = 240;
+	} else if (status == 2) {
+		r = 240;
+	} else if (status == 3) {
+		g = 240;
+	}
+	object->rects[0].r = r;
+	object->rects[0].g = g;
+	object->rects[0].b = b;
+	markDirty(object);
+}
+
+void updateText(struct Object * object, int id) {
+	char text[LAYOUT_NAME_LEN + 1];
+	idToName(id, text);
+	clearText(&(object->texts[0]));
+	addString(&(object->texts[0]), text);
+}
+
+void changeScene(int scene){
+	// Left the return time picker without a return time: the computer wasn't taken
+	if (current_scene == RETURN_SCENE && scene != RETURN_SCENE) finishAttempt(ACCESS_CANCELLED);
+
+	if ((current_scene == 0 && scene == 1) || (current_scene == 2 && scene == 0)) {
+		refreshStatus();
+	}
+
+	if (scene == 2) {
+		openLock(current_computer);
+	} else if (current_scene == 2) {
+		closeLock(current_computer);
+	}
+
+	traceEvent(TRACE_SCENE, scene);
+	switchScene(scene);
+	updateTimeTextColorAndPos();
+
+	passwd[0] = 0;
+	clearText(&(passwdText.texts[0]));
+
+	int st = computerStatus(current_computer);
+	updateColor(&bigLogo, st);
+	updateColor(&smallLogo, st);
+
+	updateText(&bigLogo, current_computer);
+	updateText(&smallLogo, current_computer);
+
+	if (scene == 0) {
+		timeText->dx = -124;
+		timeText->dy = 89;
+	} else if (scene == 1) {
+		timeText->dx = -95;
+		timeText->dy = 55;
+	} else {
+		timeText->dx = -95;
+		timeText->dy = 35;
+	}
+	markDirty(&timeTextObj);
+
+
+	printf("scene: %d, c_c: %d\n", scene, current_computer);
+	fflush(stdout);
+}
+
+void addCharP(char c) {
+	addChar(&(passwdText.texts[0]), c);
+	int i = 0;
+	while (i < LEN_PASSWD) {
+		if (passwd[i] == 0) {
+			passwd[i] = c;
+			passwd[i + 1] = 0;
+			break;
+		}
+		i++;
+	}
+}
+
+void remCharP() {
+	removeText(&(passwdText.texts[0]), 1);
+	int i = 0;
+	while (i < LEN_PASSWD) {
+		if (passwd[i]) passwd[i] = 0;
+		i++;
+	}
+}
+
+int current_page = 0;
+
+// RETURN TIME
+// Chosen after a correct PIN, the computer is reserved until then (see reserve.c)
+long return_now, return_time, return_limit;
+
+void formatTime(long t, char * s) {
+	time_t tt = t;
+	strftime(s, 6, "%H:%M", localtime(&tt));
+}
+
+// Labels are centered with the advance of Courier New, 0.52 em (see gen_layout.py)
+void centerText(struct Text * text, char * s) {
+	clearText(text);
+	addString(text, s);
+	text->dx = -text->len * text->font_size * 26 / 100;
+}
+
+void showReturnTime() {
+	char s[32], ts[6];
+	formatTime(return_time, ts);
+	centerText(returnTime, ts);
+	if (return_limit < return_now + RETURN_MAX_H * 3600L) {
+		formatTime(return_limit, ts);
+		snprintf(s, sizeof(s), "reserved from %s", ts);
+	} else {
+		snprintf(s, sizeof(s), "at most %i hours", RETURN_MAX_H);
+	}
+	centerText(returnLimit, s);
+}
+
+// Until when 'comp' is free from 'now' on. Loans don't count: one that still runs means the
+// computer was brought back early, the next correct PIN ends it (see endLoans()).
+long freeUntil(int comp, long now) {
+	return reserveLessonFreeUntil(comp, now);
+}
+
+// Cuts the loans of 'comp' that still run at 'now' back to 'now'
+void endLoans(int comp, long now) {
+	struct Reservation r;
+	while (reserveConflict(comp, now, now + 1, &r) && r.kind == RESERVE_LOAN) {
+		reserveRemove(r.id);
+		if (r.start < now) reserveAdd(comp, r.start, now, RESERVE_LOAN);
+	}
+}
+
+void showReserved(long now) {
+	char s[32], ts[6];
+	formatTime(reserveFirstFree(current_computer, now, RETURN_STEP_MIN * 60L), ts);
+	snprintf(s, sizeof(s), "Reserved until %s", ts);
+	centerText(reservedText, s);
+	changeScene(RESERVED_SCENE);
+}
+
+// After a correct PIN, 'limit' is freeUntil(now)
+void startReturnPicker(long now, long limit) {
+	long step = RETURN_STEP_MIN * 60L;
+	endLoans(current_computer, now);
+	return_now = now;
+	return_limit = limit;
+	if (return_limit > return_now + RETURN_MAX_H * 3600L) return_limit = return_now + RETURN_MAX_H * 3600L;
+
+	// On the step grid, as the buttons move it
+	return_time = (return_now + RETURN_DEFAULT_MIN * 60L + step - 1) / step * step;
+	if (return_time > return_limit) return_time = return_limit;
+	showReturnTime();
+	changeScene(RETURN_SCENE);
+}
+
+void moveReturnTime(int steps) {
+	long step = RETURN_STEP_MIN * 60L;
+	long t = (return_time + steps * step) / step * step;
+	long first = return_now + step;
+	if (t < first) t = first < return_limit ? first : return_limit;
+	if (t > return_limit) t = return_limit;
+	return_time = t;
+	showReturnTime();
+}
+
+void confirmReturnTime() {
+	long now = time(NULL);
+	// A lesson could have been booked while the picker was open, or it was open too long
+	if (return_time <= now || reserveConflict(current_computer, now, return_time, NULL)) {
+		long limit = freeUntil(current_computer, now);
+		if (limit - now < RETURN_STEP_MIN * 60L) {
+			finishAttempt(ACCESS_RESERVED);
+			showReserved(now);
+		} else {
+			startReturnPicker(now, limit);
+		}
+		return;
+	}
+	finishAttempt(ACCESS_GRANTED);
+	reserveAdd(current_computer, now, return_time, RESERVE_LOAN);
+	changeScene(2);
+}
+// RETURN TIME
+
+// Shows icon 'id' in 'tile' at the place of 'l'
+void bindTile(struct Object * tile, const struct LayoutItem * l, int id) {
+	setTouchArea(tile, l->touch.x1, l->touch.y1, l->touch.x2, l->touch.y2);
+	struct Rect * r = &tile->rects[0];
+	struct Box * b = &tile->boxes[0];
+	struct Text * t = &tile->texts[0];
+	r->x1 = b->x1 = l->box.x1;
+	r->y1 = b->y1 = l->box.y1;
+	r->x2 = b->x2 = l->box.x2;
+	r->y2 = b->y2 = l->box.y2;
+	t->x = l->text_x;
+	t->dx = l->text_dx;
+	t->y = l->text_y;
+	t->dy = l->text_dy;
+	t->font_size = l->font_size;
+	tile->data = id;
+	updateColor(tile, computerStatus(id));
+	updateText(tile, id);
+	if (tile->hide) setHidden(tile, 0);
+}
+
+// Binds the tiles to the icons of 'page', the tiles it doesn't need are hidden
+void showPage(int page) {
+	const struct LayoutPage * p = &layout_pages[page];
+	for (int k = 0; k < LAYOUT_TILES; k++) {
+		if (k < p->cnt) bindTile(&computerIcon[k], &layout_tiles[p->tile + k], p->first + k);
+		else if (!computerIcon[k].hide) setHidden(&computerIcon[k], 1);
+	}
+	current_page = page;
+}
+
+void touchEvent(struct Object * object, int x, int y) {
+	int _ev = object->touch_event, data = object->data;
+	if (_ev < 0) return;
+
+	if (_ev == 0) {
+		changeScene(data);
+	} else if (_ev == 1) {
+		current_computer = data;
+		changeScene(1);
+	} else if (_ev == 2) {
+		if (computerStatus(current_computer)) addCharP(data);
+	} else if (_ev == 3) {
+		remCharP();
+	} else if (_ev == 4) {
+		if (computerStatus(current_computer)) {
+			// Checked before the attempt is logged, so the log says why the box stayed shut
+			long now = time(NULL);
+			long limit = freeUntil(current_computer, now);
+			int res = logAttempt(current_computer, passwd, limit - now < RETURN_STEP_MIN * 60L);
+			if (res == ACCESS_GRANTED) {
+				startReturnPicker(now, limit);
+			} else if (res == ACCESS_RESERVED) {
+				printf("Computer %i is reserved from %li\n", current_computer, limit);
+				showReserved(now);
+			} else {
+				changeScene(3);
+			}
+		}
+	} else if (_ev == 5) {
+		if (current_page > 0) showPage(current_page - 1);
+	} else if (_ev == 6) {
+		if (current_page < LAYOUT_PAGES - 1) showPage(current_page + 1);
+	} else if (_ev == 7) {
+		moveReturnTime(-1);
+	} else if (_ev == 8) {
+		moveReturnTime(1);
+	} else if (_ev == 9) {
+		confirmReturnTime();
+	}
+}
+
+
+// See status.h for the meaning of the values
+int computerStatus(int id) {
+	return c_status[id];
+}
+
+// Picks up changes of computers.txt and recolors the affected icons
+int refreshStatus() {
+	int changed[MAX_COMP];
+	int cnt = statusPoll(changed, MAX_COMP);
+	// Only the icons of the current page have tiles
+	const struct LayoutPage * p = &layout_pages[current_page];
+	int recolored = 0;
+	for (int i = 0; i < cnt; i++) {
+		int k = changed[i] - p->first;
+		if (k >= 0 && k < p->cnt) {
+			updateColor(&computerIcon[k], computerStatus(changed[i]));
+			recolored++;
+		}
+	}
+	return recolored;
+}
+
+// 'name' needs LAYOUT_NAME_LEN + 1 chars
+void idToName(int id, char * name) {
+	for (int i = LAYOUT_NAME_LEN - 1; i >= 0; i--) {
+		name[i] = id % 10 + '0';
+		id /= 10;
+	}
+	name[LAYOUT_NAME_LEN] = 0;
+}
+
+// Touch area, box and label of 'l'
+void addLayoutItem(struct Object * object, const struct LayoutItem * l, int font, int max_len) {
+	setTouchArea(object, l->touch.x1, l->touch.y1, l->touch.x2, l->touch.y2);
+	addBox(object, l->box.x1, l->box.y1, l->box.x2, l->box.y2, 2);
+	struct Text * tp = addText(object, l->text_x, l->text_dx, l->text_y, l->text_dy, font, l->font_size, max_len);
+	if (l->label) addChar(tp, l->label);
+}
+
+void buildScenes(int font) {
+	// priority = 0, scene = 0
+	// Objects that change after this are marked dynamic, the rest is drawn into the scene layers
+
+
+	for (int i = 0; i < NUM_SCENES; i++) {
+		defaultObject(&backgrounds[i]);
+		backgrounds[i].priority = -1;
+		addObject(&backgrounds[i], i);
+	}
+	addColorRect(&backgrounds[0], 0, 0, width, height, 255, 255, 255, 255);
+	addColorRect(&backgrounds[1], 0, 0, width, height, 255, 255, 255, 255);
+	addColorRect(&backgrounds[2], 0, 0, width, height, 0, 32, 0, 255);
+	addColorRect(&backgrounds[3], 0, 0, width, height, 64, 0, 0, 255);
+	addColorRect(&backgrounds[4], 0, 0, width, height, 255, 255, 255, 255);
+	addColorRect(&backgrounds[5], 0, 0, width, height, 255, 255, 255, 255);
+	addColorRect(&backgrounds[6], 0, 0, width, height, 255, 255, 255, 255);
+	addColorRect(&backgrounds[7], 0, 0, width, height, 64, 40, 0, 255);
+	{
+		struct Text * tp = addText(&backgrounds[5], width / 2, -241, height / 2, -20, font, 32, 30);
+		addString(tp, "Touch the centre of the cross");
+	}
+
+	{
+		defaultObject(&bigLogo);
+		bigLogo.dynamic = 1;
+		bigLogo.priority = 1;
+		addBox(&bigLogo, 10, 90, 370, 470, 2);
+		addRect(&bigLogo, 10, 90, 370, 470);
+		// As long as idToName() makes them, -52 centres three digits
+		addText(&bigLogo, 200, -52 * LAYOUT_NAME_LEN / 3, 278, 24, font, 100, LAYOUT_NAME_LEN);
+		addObject(&bigLogo, 1);
+	}
+
+	int d = 150;
+//	if (d > width / (cnt_w + 1) - 4) {
+//		d = width / (cnt_w + 1) - 4;
+//	}
+//	if (d > height / (cnt_h) - 4) {
+//		d = height / cnt_h - 4;
+//	}
+	{
+		defaultObject(&smallLogo);
+		smallLogo.dynamic = 1;
+		smallLogo.priority = 1;
+	//	addColorBox(&smallLogo, 300, 140, 500, 340, 255, 255, 255, 255, 2);
+	//	addRect(&smallLogo, 300, 140, 500, 340);
+		int x1 = width/2 - d/2, y1 = height/2 - d/2, x2 = width/2 + d/2, y2 = height/2 + d/2;
+		addColorBox(&smallLogo, x1, y1, x2, y2, 255, 255, 255, 255, 2);
+		addRect(&smallLogo, x1, y1, x2, y2);
+		addText(&smallLogo, 400, -26 * LAYOUT_NAME_LEN / 3, 240, 13, font, 50, LAYOUT_NAME_LEN);
+		addObject(&smallLogo, 2);
+	}
+
+	// Icons, arrows, keys and back buttons are placed by layout.txt
+	if (width != LAYOUT_WIDTH || height != LAYOUT_HEIGHT) {
+		printf("layout.txt is made for %ix%i, the screen is %ix%i\n", LAYOUT_WIDTH, LAYOUT_HEIGHT, width, height);
+	}
+
+	{
+		for (int k = 0; k < LAYOUT_TILES; k++) {
+			defaultObject(&computerIcon[k]);
+			computerIcon[k].dynamic = 1;
+			computerIcon[k].priority = 1;
+			computerIcon[k].touch_event = 1;
+			// Placed by showPage()
+			addRect(&computerIcon[k], 0, 0, 0, 0);
+			addBox(&computerIcon[k], 0, 0, 0, 0, 2);
+			addText(&computerIcon[k], 0, 0, 0, 0, font, 50, 5);
+			setHidden(&computerIcon[k], 1);
+			addObject(&computerIcon[k], 0);
+		}
+		showPage(0);
+
+		{
+			defaultObject(&timeTextObj);
+			timeTextObj.dynamic = 1;
+			timeTextObj.priority = 11;
+			timeText = addText(&timeTextObj, width, -115, 0, 40, font, 32, 5);
+			timeText->dynamic = 1;
+			addObjectToAll(&timeTextObj);
+		}
+		{
+			defaultObject(&buttonL);
+			buttonL.priority = 10;
+			addLayoutItem(&buttonL, &layout_left, font, 1);
+			addColorRect(&buttonL, layout_left.box.x1, layout_left.box.y1, layout_left.box.x2, layout_left.box.y2, 255, 255, 255, 255);
+			buttonL.touch_event = 5;
+			addObject(&buttonL, 0);
+		}
+		{
+			defaultObject(&buttonR);
+			buttonR.priority = 11;
+			addLayoutItem(&buttonR, &layout_right, font, 1);
+			addColorRect(&buttonR, layout_right.box.x1, layout_right.box.y1, layout_right.box.x2, layout_right.box.y2, 255, 255, 255, 255);
+			buttonR.touch_event = 6;
+			addObject(&buttonR, 0);
+		}
+
+		{
+			for (int i = 0; i < LAYOUT_KEYS; i++) {
+				const struct LayoutItem * l = &layout_keys[i];
+				defaultObject(&buttons[i]);
+				buttons[i].priority = 1;
+				addLayoutItem(&buttons[i], l, font, 1);
+				addColorRect(&buttons[i], l->box.x1, l->box.y1, l->box.x2, l->box.y2, 0, 128, 255, 255);
+				if (l->label == '<') {
+					buttons[i].touch_event = 3;
+				} else if (l->label == '>') {
+					buttons[i].touch_event = 4;
+				} else {
+					buttons[i].touch_event = 2;
+					buttons[i].data = l->label;
+				}
+				addObject(&buttons[i], 1);
+			}
+
+			{
+				defaultObject(&passwdText);
+				passwdText.dynamic = 1;
+				addBox(&passwdText, 390, 90, width - 10, 175, 2);
+				addObject(&passwdText, 1);
+				struct Text * tp = addText(&passwdText, 390, 35 - 13, 132, 17, font, 50, LEN_PASSWD);
+				tp->dynamic = 1;
+			}
+		}
+	}
+
+	{
+		for (int i = 0; i < LAYOUT_BACKS; i++) {
+			const struct LayoutItem * l = &layout_backs[i];
+			struct Object * o = &backButton[l->scene];
+			defaultObject(o);
+			addLayoutItem(o, l, font, 1);
+			o->priority = 2;
+			o->touch_event = 0;
+			o->data = l->target;
+			addObject(o, l->scene);
+		}
+	}
+
+	{
+		// Moved by showCalibTarget()
+		defaultObject(&calibTarget);
+		calibTarget.dynamic = 1;
+		calibTarget.priority = 1;
+		addColorRect(&calibTarget, 0, 0, 0, 0, 255, 0, 0, 255);
+		addColorRect(&calibTarget, 0, 0, 0, 0, 255, 0, 0, 255);
+		addColorBox(&calibTarget, 0, 0, 0, 0, 255, 0, 0, 255, 2);
+		calibText = addText(&calibTarget, width / 2, -25, height / 2, 30, font, 32, 3);
+		calibText->dynamic = 1;
+		addObject(&calibTarget, CALIBRATION_SCENE);
+	}
+
+	{
+		struct Text * tp = addText(&backgrounds[6], width / 2, -117, 60, 13, font, 50, 9);
+		addString(tp, "Return by");
+
+		// Filled in by showReturnTime()
+		defaultObject(&returnText);
+		returnText.dynamic = 1;
+		returnTime = addText(&returnText, width / 2, 0, 220, 26, font, 100, 5);
+		returnTime->dynamic = 1;
+		returnLimit = addText(&returnText, width / 2, 0, 300, 8, font, 32, 20);
+		returnLimit->dynamic = 1;
+		addObject(&returnText, RETURN_SCENE);
+
+		struct Object * b[3] = { &returnEarlier, &returnLater, &returnOk };
+		const struct LayoutItem * l[3] = { &layout_earlier, &layout_later, &layout_ok };
+		for (int i = 0; i < 3; i++) {
+			defaultObject(b[i]);
+			b[i]->priority = 1;
+			addLayoutItem(b[i], l[i], font, 1);
+			addColorRect(b[i], l[i]->box.x1, l[i]->box.y1, l[i]->box.x2, l[i]->box.y2, 0, 128, 255, 255);
+			b[i]->touch_event = 7 + i;
+			addObject(b[i], RETURN_SCENE);
+		}
+	}
+
+	{
+		// Filled in by showReserved()
+		defaultObject(&reservedInfo);
+		reservedInfo.dynamic = 1;
+		reservedText = addColorText(&reservedInfo, width / 2, 0, height / 2, 13, font, 50, 255, 255, 255, 255, 20);
+		reservedText->dynamic = 1;
+		addObject(&reservedInfo, RESERVED_SCENE);
+	}
+
+	changeScene(0);
+	passwdText.texts[0].pswd = 0;
+
+	defaultObject(&touchMarker);
+	touchMarker.dynamic = 1;
+	addColorBox(&touchMarker, 0, 0, 1, 1, 255, 0, 0, 128, 10);
+	touchMarker.priority = 20;
+	addObjectToAll(&touchMarker);
+}
+
+// CALIBRATION
+int calib_step = 0;
+int calib_raw[3][2], calib_screen[3][2];
+
+void showCalibTarget() {
+	int x = calib_screen[calib_step][0], y = calib_screen[calib_step][1];
+	struct Rect * h = &calibTarget.rects[0];
+	struct Rect * v = &calibTarget.rects[1];
+	h->x1 = x - 30;
+	h->x2 = x + 31;
+	h->y1 = y - 1;
+	h->y2 = y + 2;
+	v->x1 = x - 1;
+	v->x2 = x + 2;
+	v->y1 = y - 30;
+	v->y2 = y + 31;
+	calibTarget.boxes[0].x1 = x - 15;
+	calibTarget.boxes[0].y1 = y - 15;
+	calibTarget.boxes[0].x2 = x + 15;
+	calibTarget.boxes[0].y2 = y + 15;
+
+	char s[4] = { '1' + calib_step, '/', '3', 0 };
+	clearText(calibText);
+	addString(calibText, s);
+	markDirty(&calibTarget);
+}
+
+void startCalibration() {
+	// Not on one line and away from the edges, where the panel is least linear
+	calib_screen[0][0] = width / 10;
+	calib_screen[0][1] = height / 10;
+	calib_screen[1][0] = width * 9 / 10;
+	calib_screen[1][1] = height / 2;
+	calib_screen[2][0] = width / 2;
+	calib_screen[2][1] = height * 9 / 10;
+	calib_step = 0;
+	showCalibTarget();
+	changeScene(CALIBRATION_SCENE);
+}
+
+int calibrationTouch(int rx, int ry, struct Calibration * cal) {
+	calib_raw[calib_step][0] = rx;
+	calib_raw[calib_step][1] = ry;
+	calib_step++;
+	if (calib_step < 3) {
+		showCalibTarget();
+		return 0;
+	}
+
+	calib_step = 0;
+	if (calibSolve((const int (*)[2]) calib_raw, (const int (*)[2]) calib_screen, cal) != 0) {
+		printf("Calibration touches are on one line, starting again\n");
+		fflush(stdout);
+		showCalibTarget();
+		return 0;
+	}
+	printf("calibration: %i %i %i %i %i %i\n", cal->a, cal->b, cal->c, cal->d, cal->e, cal->f);
+	fflush(stdout);
+	return 1;
+}
+// CALIBRATION
+
+void showTouch(int x, int y) {
+	touchMarker.boxes[0].x1 = x - 50;
+	touchMarker.boxes[0].x2 = x + 50;
+	touchMarker.boxes[0].y1 = y - 50;
+	touchMarker.boxes[0].y2 = y + 50;
+	markDirty(&touchMarker);
+}
@@ -0,0 +1,70 @@
+#ifndef SCENES_H
+#define SCENES_H
+
+#include "calib.h"
+#include "ui.h"
+
+#define NUM_SCENES 8
+/*
+	SCENES:
+
+0 - Contains the option(s) to select a computer to take
+1 - Authorisation
+2 - Access granted
+3 - Access denied
+4 - Help!
+5 - Touch calibration
+6 - Return time
+7 - Reserved
+*/
+
+#define CALIBRATION_SCENE 5
+#define RETURN_SCENE 6
+#define RESERVED_SCENE 7
+
+// Return time picker: step of the buttons, first suggestion and the longest loan
+#define RETURN_STEP_MIN 15
+#define RETURN_DEFAULT_MIN 60
+#define RETURN_MAX_H 24
+
+#define LEN_PASSWD 6
+#define MAX_BUTTONS 20
+
+extern int current_computer;
+extern int current_page;
+extern char passwd[LEN_PASSWD + 1];
+
+extern struct Object computerIcon[];
+extern struct Object buttons[MAX_BUTTONS];
+extern struct Object backButton[NUM_SCENES];
+extern struct Object buttonL, buttonR;
+extern struct Object returnEarlier, returnLater, returnOk;
+
+// Creates the objects of all scenes and shows scene 0. 'font' is a render->createFont() id.
+void buildScenes(int font);
+void changeScene(int scene);
+void setTime(int hour, int min);
+void updateTime();
+// Picks up changes of computers.txt and recolors the affected icons. Returns their number.
+int refreshStatus();
+int computerStatus(int id);
+// Moves the touch marker to (x, y)
+void showTouch(int x, int y);
+
+// Shows the calibration targets one after another
+void startCalibration();
+// Raw readings of a touch of the current target. Returns 1 and fills 'cal' after the last one.
+int calibrationTouch(int rx, int ry, struct Calibration * cal);
+
+// 'name' needs LAYOUT_NAME_LEN + 1 chars (layout_gen.h)
+void idToName(int id, char * name);
+
+// Implemented by the program (main.c)
+// Returns ACCESS_DENIED, ACCESS_RESERVED (if 'reserved') or ACCESS_GRANTED (accesslog.h).
+// A grant is logged only by finishAttempt(), once the computer is taken or not.
+int logAttempt(int id, char * pswd, int reserved);
+void finishAttempt(int outcome);
+void openLock(int comp);
+void closeLock(int comp);
+
+#endif
@@ -0,0 +1,191 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "scheduler.h"
+#include "render.h"
+#include "status.h"
+#include "trace.h"
+#include "ui.h"
+
+struct FrameStats frame_stats;
+
+static struct SchedulerParams params;
+static pthread_t thread;
+static volatile int running = 0;
+
+static pthread_mutex_t ui_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_mutex_t kick_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t kick_cond = PTHREAD_COND_INITIALIZER;
+static int kicked = 0;
+static long kick_time = 0; // of the first kick since the last frame
+static int setup_done = 0, setup_res = -1;
+
+static struct Snapshot snap;
+
+void uiLock() {
+	pthread_mutex_lock(&ui_lock);
+}
+
+void uiUnlock() {
+	pthread_mutex_unlock(&ui_lock);
+}
+
+void schedulerKick() {
+	pthread_mutex_lock(&kick_lock);
+	if (!kicked) {
+		kicked = 1;
+		kick_time = monotonicUs();
+	}
+	pthread_cond_signal(&kick_cond);
+	pthread_mutex_unlock(&kick_lock);
+}
+
+static int bucket(long us) {
+	long ms = us / 1000;
+	int b = 0;
+	while (ms > 0 && b < FRAME_HIST - 1) {
+		ms >>= 1;
+		b++;
+	}
+	return b;
+}
+
+// Waits for a kick, at most a second for the clock
+static void waitKick() {
+	pthread_mutex_lock(&kick_lock);
+	if (!kicked && running) {
+		struct timespec ts;
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec++;
+		pthread_cond_timedwait(&kick_cond, &kick_lock, &ts);
+	}
+	pthread_mutex_unlock(&kick_lock);
+}
+
+// Returns the time of the first kick since the last call, 0 if there was none
+static long takeKick() {
+	pthread_mutex_lock(&kick_lock);
+	long t = kicked ? kick_time : 0;
+	kicked = 0;
+	pthread_mutex_unlock(&kick_lock);
+	return t;
+}
+
+static void * renderLoop(void * arg) {
+	int res = params.setup();
+	pthread_mutex_lock(&kick_lock);
+	setup_res = res;
+	setup_done = 1;
+	pthread_cond_broadcast(&kick_cond);
+	pthread_mutex_unlock(&kick_lock);
+	if (res != 0) return NULL;
+
+	long frame_us = 1000000 / params.max_fps;
+	long next_frame = 0;
+	long minute = -1;
+	while (running) {
+		waitKick();
+		if (!running) break;
+
+		// Changes made while waiting for the FPS limit go into the same frame
+		long now = monotonicUs();
+		if (now < next_frame) usleep(next_frame - now);
+
+		long kick = takeKick();
+		uiLock();
+		long start = monotonicUs();
+		if (time(NULL) / 60 != minute) {
+			minute = time(NULL) / 60;
+			if (params.tick) params.tick();
+		}
+		int damaged = updateDamage();
+		if (damaged) takeSnapshot(&snap);
+		uiUnlock();
+
+		if (!damaged) {
+			frame_stats.idle++;
+			continue;
+		}
+
+		traceEvent(TRACE_DRAW_START, 0);
+		render->beginFrame();
+		drawSnapshot(&snap);
+		traceEvent(TRACE_DRAW_END, 0);
+		render->endFrame();
+		traceEvent(TRACE_UPLOAD, 0);
+
+		long end = monotonicUs();
+		uiLock();
+		frameShown();
+		if (params.shown) params.shown();
+		uiUnlock();
+
+		long render_us = end - start;
+		long latency_us = end - (kick ? kick : start);
+		frame_stats.frames++;
+		frame_stats.render_hist[bucket(render_us)]++;
+		frame_stats.latency_hist[bucket(latency_us)]++;
+		if (render_us > frame_stats.max_render_us) frame_stats.max_render_us = render_us;
+		if (latency_us > frame_stats.max_latency_us) frame_stats.max_latency_us = latency_us;
+		if (latency_us > params.deadline_ms * 1000L) frame_stats.missed++;
+		next_frame = start + frame_us;
+	}
+
+	if (params.teardown) params.teardown();
+	return NULL;
+}
+
+int schedulerInit(struct SchedulerParams * p) {
+	params = *p;
+	if (params.max_fps <= 0) params.max_fps = FRAME_MAX_FPS;
+	if (params.deadline_ms <= 0) params.deadline_ms = FRAME_DEADLINE_MS;
+
+	running = 1;
+	if (pthread_create(&thread, NULL, renderLoop, NULL) != 0) {
+		perror("pthread_create");
+		running = 0;
+		return -1;
+	}
+
+	pthread_mutex_lock(&kick_lock);
+	while (!setup_done) pthread_cond_wait(&kick_cond, &kick_lock);
+	pthread_mutex_unlock(&kick_lock);
+	if (setup_res != 0) {
+		running = 0;
+		pthread_join(thread, NULL);
+	}
+	return setup_res;
+}
+
+static void printHist(FILE * f, const char * name, long * hist) {
+	fprintf(f, "%-8s", name);
+	for (int i = 0; i < FRAME_HIST; i++) fprintf(f, " %6ld", hist[i]);
+	fprintf(f, "\n");
+}
+
+void schedulerPrintStats(FILE * f) {
+	fprintf(f, "frames: %ld drawn, %ld idle wakeups, %ld later than %i ms\n",
+		frame_stats.frames, frame_stats.idle, frame_stats.missed, params.deadline_ms);
+	fprintf(f, "max render: %ld us, max latency: %ld us\n", frame_stats.max_render_us, frame_stats.max_latency_us);
+	fprintf(f, "%-8s", "ms");
+	for (int i = 0; i < FRAME_HIST; i++) {
+		if (i == 0) fprintf(f, " %6s", "<1");
+		else if (i == FRAME_HIST - 1) fprintf(f, " %5i+", 1 << (i - 1));
+		else fprintf(f, " %6i", 1 << (i - 1));
+	}
+	fprintf(f, "\n");
+	printHist(f, "render", frame_stats.render_hist);
+	printHist(f, "latency", frame_stats.latency_hist);
+}
+
+void schedulerClose() {
+	if (!running) return;
+	pthread_mutex_lock(&kick_lock);
+	running = 0;
+	pthread_cond_signal(&kick_cond);
+	pthread_mutex_unlock(&kick_lock);
+	pthread_join(thread, NULL);
+}
@@ -0,0 +1,52 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdio.h>
+
+#define FRAME_MAX_FPS 30
+// A frame that ends later than this after the change it shows is counted as missed
+#define FRAME_DEADLINE_MS 50
+// Bucket 0 counts frames under 1 ms, bucket i frames of [2^(i-1), 2^i) ms, the last one the rest
+#define FRAME_HIST 10
+
+struct FrameStats {
+	long frames, missed;
+	long idle;	// wakeups with nothing to draw
+	long render_hist[FRAME_HIST];	// snapshot, draw and upload
+	long latency_hist[FRAME_HIST];	// from schedulerKick() to the end of the frame
+	long max_render_us, max_latency_us;
+};
+
+extern struct FrameStats frame_stats;
+
+struct SchedulerParams {
+	int max_fps;
+	int deadline_ms;
+	// Called on the render thread, the render backend must be created there.
+	// setup() runs before the first frame and returns 0 on success, teardown() after the last one.
+	int (*setup)();
+	void (*teardown)();
+	// Called with the UI locked when the clock minute changes and after every frame
+	void (*tick)();
+	void (*shown)();
+};
+
+/*
+	Draws frames on its own thread. A frame is drawn only after schedulerKick() or a change of
+	the clock minute, at most 'max_fps' times a second. The damaged objects are copied with the
+	UI locked and drawn after it is unlocked (see takeSnapshot()).
+	Waits for setup() and returns its result, -1 if the thread didn't start.
+*/
+int schedulerInit(struct SchedulerParams * params);
+
+// Objects, scenes and ui_arena are shared with the render thread, change them only between these
+void uiLock();
+void uiUnlock();
+
+// Something has changed, draw a frame as soon as the FPS limit allows
+void schedulerKick();
+
+void schedulerPrintStats(FILE * f);
+void schedulerClose();
+
+#endif
@@ -0,0 +1,108 @@
+/*
+	Prints the occupancy log written by snapshot.c, oldest first: every slot that was
+	emptied or filled and every keyframe with the slots that were occupied.
+
+	./snapdump [file]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "snapshot.h"
+
+struct Dump {
+	unsigned char prev[SNAP_MAX_SLOTS / 8];
+	int have_prev;
+	long records, changes, first_t, last_t;
+};
+
+static void printTime(long t) {
+	char date[32];
+	struct tm tm;
+	time_t tt = t;
+	localtime_r(&tt, &tm);
+	strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &tm);
+	printf("%s", date);
+}
+
+static void onRecord(void * ctx, long t, int key, const unsigned char * bitmap) {
+	struct Dump * d = (struct Dump *) ctx;
+	if (d->records == 0) d->first_t = t;
+	d->records++;
+	d->last_t = t;
+
+	if (key) {
+		int present = 0;
+		for (int i = 0; i < SNAP_MAX_SLOTS; i++) present += (bitmap[i / 8] >> (i % 8)) & 1;
+		printTime(t);
+		printf(" keyframe, %d present:", present);
+		for (int i = 0; i < SNAP_MAX_SLOTS; i++) {
+			if ((bitmap[i / 8] >> (i % 8)) & 1) printf(" %d", i);
+		}
+		printf("\n");
+	}
+	// A keyframe after a gap shows what changed meanwhile
+	for (int i = 0; d->have_prev && i < SNAP_MAX_SLOTS; i++) {
+		int was = (d->prev[i / 8] >> (i % 8)) & 1, is = (bitmap[i / 8] >> (i % 8)) & 1;
+		if (was == is) continue;
+		printTime(t);
+		printf(" slot %d %s\n", i, is ? "filled" : "emptied");
+		d->changes++;
+	}
+	memcpy(d->prev, bitmap, sizeof(d->prev));
+	d->have_prev = 1;
+}
+
+struct Block {
+	unsigned int seq;
+	long off;
+};
+
+static int cmpBlocks(const void * a, const void * b) {
+	unsigned int x = ((const struct Block *) a)->seq, y = ((const struct Block *) b)->seq;
+	return x < y ? -1 : x > y;
+}
+
+int main(int argc, char * argv[]) {
+	const char * path = argc > 1 ? argv[1] : SNAPSHOT_FILE;
+	FILE * f = fopen(path, "rb");
+	if (f == NULL) {
+		perror(path);
+		return 1;
+	}
+	struct SnapFileHeader fh;
+	if (fread(&fh, sizeof(fh), 1, f) != 1 || fh.magic != SNAP_MAGIC || fh.version != SNAP_VERSION) {
+		fprintf(stderr, "%s is not an occupancy log\n", path);
+		return 1;
+	}
+
+	struct Block * blocks = (struct Block *) malloc(sizeof(struct Block) * fh.blocks);
+	unsigned char * b = (unsigned char *) malloc(fh.block_size);
+	int cnt = 0;
+	for (unsigned int i = 0; i < fh.blocks; i++) {
+		struct SnapBlockHeader bh;
+		long off = sizeof(fh) + (long) i * fh.block_size;
+		if (fseek(f, off, SEEK_SET) != 0 || fread(&bh, sizeof(bh), 1, f) != 1) break;
+		if (bh.magic != SNAP_MAGIC) continue;
+		blocks[cnt].seq = bh.seq;
+		blocks[cnt].off = off;
+		cnt++;
+	}
+	qsort(blocks, cnt, sizeof(struct Block), cmpBlocks);
+
+	struct Dump d;
+	memset(&d, 0, sizeof(d));
+	for (int i = 0; i < cnt; i++) {
+		if (fseek(f, blocks[i].off, SEEK_SET) != 0 || fread(b, fh.block_size, 1, f) != 1) break;
+		if (snapDecodeBlock(b, fh.block_size, onRecord, &d) < 0) {
+			fprintf(stderr, "%s: block %u is broken\n", path, blocks[i].seq);
+		}
+	}
+	fclose(f);
+
+	fprintf(stderr, "%d of %u blocks used, %ld records, %ld changes", cnt, fh.blocks, d.records, d.changes);
+	if (d.records > 0) fprintf(stderr, " over %.1f days", (d.last_t - d.first_t) / 86400.0);
+	fprintf(stderr, "\n");
+	return 0;
+}
@@ -0,0 +1,298 @@
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "snapshot.h"
+#include "status.h"
+
+#define BITMAP_BYTES (SNAP_MAX_SLOTS / 8)
+
+struct SnapStats snap_stats;
+
+struct Sensor {
+	int slot, gpio, level;
+};
+
+static struct Sensor sensors[SNAP_MAX_SLOTS];
+static int cnt_sensors = 0;
+static int bitmap_bytes = 0; // bytes up to the highest slot
+
+static uint64_t (*read_banks)() = NULL;
+static void (*sink)(const void * data, int len) = NULL;
+static int fd = -1;
+static pthread_t thread;
+static pthread_mutex_t stop_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stop_cond = PTHREAD_COND_INITIALIZER;
+static int running = 0;
+
+// Block being written
+static unsigned char block[SNAP_BLOCK];
+static int block_pos = 0;
+static uint32_t seq = 0;
+static long last_t = 0, last_key = 0;
+static unsigned char state[BITMAP_BYTES];
+
+static int putVarint(unsigned char * p, unsigned long v) {
+	int n = 0;
+	while (v >= 0x80) {
+		p[n++] = (v & 0x7f) | 0x80;
+		v >>= 7;
+	}
+	p[n++] = v;
+	return n;
+}
+
+static int getVarint(const unsigned char * p, int len, unsigned long * v) {
+	*v = 0;
+	for (int n = 0; n < len && n < 10; n++) {
+		*v |= (unsigned long) (p[n] & 0x7f) << (7 * n);
+		if (!(p[n] & 0x80)) return n + 1;
+	}
+	return -1;
+}
+
+static int loadSensors(const char * path) {
+	FILE * f = fopen(path, "r");
+	if (f == NULL) {
+		fprintf(stderr, "Can't read %s, occupancy isn't logged\n", path);
+		return -1;
+	}
+	char line[256];
+	cnt_sensors = 0;
+	bitmap_bytes = 0;
+	while (fgets(line, sizeof(line), f) && cnt_sensors < SNAP_MAX_SLOTS) {
+		struct Sensor s;
+		s.level = 1;
+		if (sscanf(line, "%d %d %d", &s.slot, &s.gpio, &s.level) < 2) continue;
+		if (s.slot < 0 || s.slot >= SNAP_MAX_SLOTS || s.gpio < 0 || s.gpio > 53) continue;
+		s.level = s.level ? 1 : 0;
+		sensors[cnt_sensors++] = s;
+		if (s.slot / 8 + 1 > bitmap_bytes) bitmap_bytes = s.slot / 8 + 1;
+	}
+	fclose(f);
+	return 0;
+}
+
+static void sample(unsigned char * bitmap) {
+	uint64_t banks = read_banks();
+	memset(bitmap, 0, BITMAP_BYTES);
+	for (int i = 0; i < cnt_sensors; i++) {
+		struct Sensor * s = &sensors[i];
+		if ((int) ((banks >> s->gpio) & 1) == s->level) bitmap[s->slot / 8] |= 1 << (s->slot % 8);
+	}
+}
+
+// RING FILE
+
+static void writeBlock() {
+	off_t off = sizeof(struct SnapFileHeader) + (off_t) ((seq - 1) % SNAP_BLOCKS) * SNAP_BLOCK;
+	if (pwrite(fd, block, SNAP_BLOCK, off) != SNAP_BLOCK || fdatasync(fd) != 0) perror("occupancy log");
+	snap_stats.bytes += SNAP_BLOCK;
+}
+
+static int keyframe(unsigned char * p, long t, const unsigned char * bitmap) {
+	int n = 0;
+	p[n++] = 'K';
+	n += putVarint(p + n, t);
+	n += putVarint(p + n, bitmap_bytes);
+	memcpy(p + n, bitmap, bitmap_bytes);
+	return n + bitmap_bytes;
+}
+
+static void newBlock(long t) {
+	seq++;
+	memset(block, 0, SNAP_BLOCK);
+	struct SnapBlockHeader h = { SNAP_MAGIC, seq };
+	memcpy(block, &h, sizeof(h));
+	block_pos = sizeof(h);
+	block_pos += keyframe(block + block_pos, t, state);
+	if (sink) sink(block + sizeof(h), block_pos - sizeof(h));
+	last_t = last_key = t;
+	snap_stats.blocks++;
+	snap_stats.keyframes++;
+}
+
+// Appends a record, the first one that doesn't fit goes to a new block as its keyframe
+static void append(const unsigned char * rec, int len, long t) {
+	// One byte stays for the end mark
+	if (block_pos + len + 1 > SNAP_BLOCK) {
+		newBlock(t);
+	} else {
+		memcpy(block + block_pos, rec, len);
+		block_pos += len;
+		last_t = t;
+		if (sink) sink(rec, len);
+	}
+	writeBlock();
+}
+
+static void record(long t, const unsigned char * bitmap) {
+	// Slots that flipped since the last sample
+	unsigned char rec[16 + 10 * SNAP_MAX_SLOTS / 8];
+	int slots[SNAP_MAX_SLOTS];
+	int cnt = 0;
+	for (int i = 0; i < bitmap_bytes; i++) {
+		unsigned char x = bitmap[i] ^ state[i];
+		for (int b = 0; x; b++, x >>= 1) {
+			if (x & 1) slots[cnt++] = i * 8 + b;
+		}
+	}
+	memcpy(state, bitmap, bitmap_bytes);
+	snap_stats.samples++;
+
+	if (cnt == 0 && t - last_key < SNAP_KEYFRAME_S) return;
+	int n = 0;
+	if (t - last_key >= SNAP_KEYFRAME_S || cnt * 2 > bitmap_bytes * 8) {
+		// Also when the delta would be bigger than the bitmap
+		n = keyframe(rec, t, state);
+		last_key = t;
+		snap_stats.keyframes++;
+	} else {
+		rec[n++] = 'D';
+		n += putVarint(rec + n, t - last_t);
+		n += putVarint(rec + n, cnt);
+		int prev = 0;
+		for (int i = 0; i < cnt; i++) {
+			n += putVarint(rec + n, slots[i] - prev);
+			prev = slots[i];
+		}
+		snap_stats.changes++;
+	}
+	append(rec, n, t);
+}
+
+// Continues after the newest block of an existing file
+static int openRing(const char * path) {
+	fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		perror(path);
+		return -1;
+	}
+	struct SnapFileHeader fh;
+	if (pread(fd, &fh, sizeof(fh), 0) != sizeof(fh) || fh.magic != SNAP_MAGIC || fh.version != SNAP_VERSION
+		|| fh.block_size != SNAP_BLOCK || fh.blocks != SNAP_BLOCKS) {
+		// New or of other dimensions, started over
+		struct SnapFileHeader h = { SNAP_MAGIC, SNAP_VERSION, SNAP_BLOCK, SNAP_BLOCKS };
+		if (ftruncate(fd, 0) != 0 || pwrite(fd, &h, sizeof(h), 0) != sizeof(h)) {
+			perror(path);
+			return -1;
+		}
+		seq = 0;
+		return 0;
+	}
+	for (int i = 0; i < SNAP_BLOCKS; i++) {
+		struct SnapBlockHeader bh;
+		off_t off = sizeof(fh) + (off_t) i * SNAP_BLOCK;
+		if (pread(fd, &bh, sizeof(bh), off) != sizeof(bh)) break;
+		if (bh.magic == SNAP_MAGIC && bh.seq > seq) seq = bh.seq;
+	}
+	return 0;
+}
+// RING FILE
+
+static void * sampler(void * arg) {
+	unsigned char bitmap[BITMAP_BYTES];
+	// The sensors could have changed while the program wasn't running
+	sample(state);
+	newBlock(time(NULL));
+	writeBlock();
+
+	long next = monotonicUs();
+	pthread_mutex_lock(&stop_lock);
+	while (running) {
+		next += SNAP_PERIOD_MS * 1000L;
+		long wait = next - monotonicUs();
+		if (wait > 0) {
+			struct timespec ts;
+			clock_gettime(CLOCK_REALTIME, &ts);
+			ts.tv_sec += wait / 1000000;
+			ts.tv_nsec += wait % 1000000 * 1000;
+			if (ts.tv_nsec >= 1000000000L) {
+				ts.tv_sec++;
+				ts.tv_nsec -= 1000000000L;
+			}
+			pthread_cond_timedwait(&stop_cond, &stop_lock, &ts);
+			if (!running) break;
+		}
+		pthread_mutex_unlock(&stop_lock);
+		sample(bitmap);
+		record(time(NULL), bitmap);
+		pthread_mutex_lock(&stop_lock);
+	}
+	pthread_mutex_unlock(&stop_lock);
+	return NULL;
+}
+
+int snapshotInit(const char * sensors_path, const char * path, uint64_t (*readBanks)(),
+	void (*sinkFn)(const void * data, int len)) {
+	sink = sinkFn;
+	if (loadSensors(sensors_path) != 0 || cnt_sensors == 0) return -1;
+	if (openRing(path) != 0) return -1;
+	read_banks = readBanks;
+	running = 1;
+	if (pthread_create(&thread, NULL, sampler, NULL) != 0) {
+		perror("pthread_create");
+		running = 0;
+		return -1;
+	}
+	return 0;
+}
+
+void snapshotClose() {
+	if (!running) return;
+	pthread_mutex_lock(&stop_lock);
+	running = 0;
+	pthread_cond_signal(&stop_cond);
+	pthread_mutex_unlock(&stop_lock);
+	pthread_join(thread, NULL);
+	close(fd);
+	fd = -1;
+}
+
+int snapDecodeBlock(const unsigned char * b, int size,
+	void (*record)(void * ctx, long t, int key, const unsigned char * bitmap), void * ctx) {
+	unsigned char bitmap[BITMAP_BYTES];
+	struct SnapBlockHeader h;
+	if (size < (int) sizeof(h)) return -1;
+	memcpy(&h, b, sizeof(h));
+	if (h.magic != SNAP_MAGIC) return -1;
+
+	int pos = sizeof(h), cnt = 0;
+	long t = 0;
+	memset(bitmap, 0, sizeof(bitmap));
+	while (pos < size && b[pos] != 0) {
+		int type = b[pos++], n;
+		unsigned long v, len;
+		if ((n = getVarint(b + pos, size - pos, &v)) < 0) return -1;
+		pos += n;
+		if ((n = getVarint(b + pos, size - pos, &len)) < 0) return -1;
+		pos += n;
+
+		if (type == 'K') {
+			if (len > BITMAP_BYTES || pos + (int) len > size) return -1;
+			t = v;
+			memset(bitmap, 0, sizeof(bitmap));
+			memcpy(bitmap, b + pos, len);
+			pos += len;
+		} else if (type == 'D' && cnt > 0) {
+			t += v;
+			unsigned long slot = 0;
+			for (unsigned long i = 0; i < len; i++) {
+				unsigned long d;
+				if ((n = getVarint(b + pos, size - pos, &d)) < 0) return -1;
+				pos += n;
+				slot += d;
+				if (slot >= SNAP_MAX_SLOTS) return -1;
+				bitmap[slot / 8] ^= 1 << (slot % 8);
+			}
+		} else {
+			return -1;
+		}
+		cnt++;
+		record(ctx, t, type == 'K', bitmap);
+	}
+	return cnt;
+}
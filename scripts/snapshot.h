@@ -0,0 +1,62 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+
+#define SENSORS_FILE "sensors.txt"
+#define SNAPSHOT_FILE "../logs/occupancy.ring"
+#define SNAP_MAX_SLOTS 1024
+#define SNAP_PERIOD_MS 1000
+// A full bitmap is written at least this often, even if nothing changed
+#define SNAP_KEYFRAME_S 3600
+// The ring file: SNAP_BLOCKS blocks of SNAP_BLOCK bytes, 16 MB
+#define SNAP_BLOCK 4096
+#define SNAP_BLOCKS 4096
+
+#define SNAP_MAGIC 0x50414e53 // "SNAP"
+#define SNAP_VERSION 1
+
+/*
+	One line of sensors.txt: "<slot> <gpio> [<present level>]"
+
+slot          - GUI id of the computer, other numbers < SNAP_MAX_SLOTS for other sensors (chargers)
+present level - level of the gpio when the slot is occupied (1 by default)
+
+	Every second the GPIO banks are read at once and turned into a bitmap, one bit per slot.
+	The ring file has a header and SNAP_BLOCKS blocks, each block starts with its own
+	keyframe, so a block can be read without the ones before it. The oldest block is
+	overwritten. Records in a block, numbers are LEB128 varints:
+
+	'K' <unix time> <bytes> <bitmap>                  - keyframe
+	'D' <seconds since the last record> <cnt> <slot>... - XOR delta: the slots that flipped,
+	                                                    ascending, each one minus the previous
+	0                                                  - end of the block
+*/
+
+struct SnapFileHeader {
+	uint32_t magic, version, block_size, blocks;
+};
+
+struct SnapBlockHeader {
+	uint32_t magic, seq; // seq starts at 1, the block with the highest one is the newest
+};
+
+struct SnapStats {
+	long samples, changes, keyframes, blocks, bytes;
+};
+
+extern struct SnapStats snap_stats;
+
+// Reads sensors.txt, opens the ring file and starts sampling every SNAP_PERIOD_MS.
+// 'readBanks' returns the levels of gpio 0-53 (bit n = gpio n). 'sink' gets every keyframe
+// and record as it is added, NULL if they go nowhere else.
+int snapshotInit(const char * sensors, const char * path, uint64_t (*readBanks)(),
+	void (*sink)(const void * data, int len));
+void snapshotClose();
+
+// For readers: calls 'record' after every record of a block with the state after it.
+// Returns the number of records, -1 if the block is broken.
+int snapDecodeBlock(const unsigned char * block, int size,
+	void (*record)(void * ctx, long t, int key, const unsigned char * bitmap), void * ctx);
+
+#endif
@@ -0,0 +1,97 @@
+/*
+	Reads touch samples as fast as possible in the ways below and prints samples per second
+	and the CPU time per sample of this thread and of the whole process (pigpio included).
+
+	old       - X and Y with a spiXfer() of 3 bytes each, as touch.c did before
+	batched   - X and Y in one spiXfer() of 5 bytes
+	touchspi  - touchSpiRead(): X and Y TOUCH_CONVERSIONS times and Z1/Z2 in one spiXfer()
+
+	Needs the Pi and root: sudo ./spibench [samples] [spi speed]
+*/
+#include <pigpio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "touch.h"
+#include "touchspi.h"
+
+int handle;
+
+static long clockUs(clockid_t clock) {
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+	return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+static int reading(char * buf) {
+	return ((buf[0] & 0x7f) << 8) | (unsigned char) buf[1];
+}
+
+// Checksum of the readings, so the loops can't be dropped
+long sink = 0;
+
+void readOld() {
+	char buf[3] = { XPT_Y, 0x00, 0x00 };
+	spiXfer(handle, buf, buf, 3);
+	sink += reading(buf + 1);
+	buf[0] = XPT_X;
+	buf[1] = buf[2] = 0;
+	spiXfer(handle, buf, buf, 3);
+	sink += reading(buf + 1);
+}
+
+void readBatched() {
+	char buf[5] = { XPT_Y, 0x00, XPT_X, 0x00, 0x00 };
+	spiXfer(handle, buf, buf, 5);
+	sink += reading(buf + 1) + reading(buf + 3);
+}
+
+void readTouchSpi() {
+	struct TouchRaw r;
+	touchSpiRead(handle, &r);
+	sink += r.x + r.y + r.z1 + r.z2;
+}
+
+void run(const char * name, void (*read)(), int samples) {
+	long t = clockUs(CLOCK_MONOTONIC);
+	long cpu = clockUs(CLOCK_THREAD_CPUTIME_ID);
+	long pcpu = clockUs(CLOCK_PROCESS_CPUTIME_ID);
+	for (int i = 0; i < samples; i++) read();
+	t = clockUs(CLOCK_MONOTONIC) - t;
+	cpu = clockUs(CLOCK_THREAD_CPUTIME_ID) - cpu;
+	pcpu = clockUs(CLOCK_PROCESS_CPUTIME_ID) - pcpu;
+	printf("%-10s %10.0f %12.2f %12.2f %12.2f\n", name, samples * 1000000.0 / t,
+		(double) t / samples, (double) cpu / samples, (double) pcpu / samples);
+}
+
+int main(int argc, char * argv[]) {
+	int samples = 20000;
+	int speed = TOUCH_SPI_SPEED;
+	if (argc > 1) samples = atoi(argv[1]);
+	if (argc > 2) speed = atoi(argv[2]);
+
+	if (gpioInitialise() < 0) {
+		printf("initialize error\n");
+		return 1;
+	}
+	handle = spiOpen(0, speed, 0);
+	if (handle < 0) {
+		printf("SPI open error\n");
+		gpioTerminate();
+		return 1;
+	}
+
+	printf("%d samples at %d Hz\n", samples, speed);
+	printf("%-10s %10s %12s %12s %12s\n", "read", "samples/s", "us/sample", "cpu us", "process us");
+	// Untimed, so the first run doesn't pay for the warm up
+	for (int i = 0; i < samples / 10; i++) readOld();
+	run("old", readOld, samples);
+	run("batched", readBatched, samples);
+	run("touchspi", readTouchSpi, samples);
+
+	spiClose(handle);
+	gpioTerminate();
+	fprintf(stderr, "%ld\n", sink);
+	return 0;
+}
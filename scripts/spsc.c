@@ -0,0 +1,37 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "spsc.h"
+
+void spscInit(struct Spsc * q, unsigned int cap, size_t elem) {
+	unsigned int c = 2;
+	while (c < cap) c *= 2;
+	q->cap = c;
+	q->elem = elem;
+	q->buf = (char *) malloc(elem * c);
+	atomic_init(&q->head, 0);
+	atomic_init(&q->tail, 0);
+}
+
+void spscFree(struct Spsc * q) {
+	free(q->buf);
+	q->buf = NULL;
+}
+
+int spscPush(struct Spsc * q, const void * item) {
+	unsigned int head = atomic_load_explicit(&q->head, memory_order_relaxed);
+	unsigned int tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+	if (head - tail == q->cap) return 0;
+	memcpy(q->buf + (head & (q->cap - 1)) * q->elem, item, q->elem);
+	atomic_store_explicit(&q->head, head + 1, memory_order_release);
+	return 1;
+}
+
+int spscPop(struct Spsc * q, void * item) {
+	unsigned int tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+	unsigned int head = atomic_load_explicit(&q->head, memory_order_acquire);
+	if (head == tail) return 0;
+	memcpy(item, q->buf + (tail & (q->cap - 1)) * q->elem, q->elem);
+	atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+	return 1;
+}
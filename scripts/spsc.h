@@ -0,0 +1,24 @@
+#ifndef SPSC_H
+#define SPSC_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+// Lock-free ring for exactly one producer thread and one consumer thread
+struct Spsc {
+	atomic_uint head; // next slot to write, touched by the producer
+	atomic_uint tail; // next slot to read, touched by the consumer
+	unsigned int cap; // power of two
+	size_t elem;
+	char * buf;
+};
+
+// 'cap' is rounded up to a power of two
+void spscInit(struct Spsc * q, unsigned int cap, size_t elem);
+void spscFree(struct Spsc * q);
+
+// Both return 1 on success, 0 if the ring is full / empty
+int spscPush(struct Spsc * q, const void * item);
+int spscPop(struct Spsc * q, void * item);
+
+#endif
@@ -0,0 +1,105 @@
+#include <errno.h>
+#include <libgen.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "status.h"
+#include "computers.h"
+
+int c_status[MAX_COMP];
+struct StatusMetrics status_metrics;
+
+static int inotify_fd = -1;
+static int seen_version = -1;
+static char watched_name[256];
+
+long monotonicUs() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+// One pass over the table. Returns the number of changed slots.
+static int recalc(int * changed, int max) {
+	int st[MAX_COMP];
+	memset(st, 0, sizeof(st));
+	for (int i = 0; i < cnt_computers; i++) {
+		int g = computers[i].gui_id;
+		if (g >= 0 && g < MAX_COMP) st[g] = 1;
+	}
+
+	int cnt = 0;
+	for (int i = 0; i < MAX_COMP; i++) {
+		if (st[i] != c_status[i]) {
+			c_status[i] = st[i];
+			if (cnt < max) changed[cnt] = i;
+			cnt++;
+		}
+	}
+	seen_version = computers_version;
+	return cnt < max ? cnt : max;
+}
+
+int statusInit(const char * path) {
+	long start = monotonicUs();
+	if (computers == NULL && computersLoad(path) < 0) {
+		fprintf(stderr, "Can't read %s\n", path);
+		return -1;
+	}
+	recalc(NULL, 0);
+
+	// Editors usually replace the file, so the directory is watched, not the file itself
+	char dir[256], name[256];
+	strncpy(dir, path, sizeof(dir) - 1);
+	strncpy(name, path, sizeof(name) - 1);
+	strncpy(watched_name, basename(name), sizeof(watched_name) - 1);
+
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_fd < 0 || inotify_add_watch(inotify_fd, dirname(dir), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+		perror("inotify");
+		if (inotify_fd >= 0) close(inotify_fd);
+		inotify_fd = -1;
+	}
+
+	long t = monotonicUs() - start;
+	status_metrics.cnt_refresh = 1;
+	status_metrics.last_refresh_us = status_metrics.max_refresh_us = status_metrics.total_refresh_us = t;
+	return 0;
+}
+
+int statusPoll(int * changed, int max) {
+	int modified = 0;
+	if (inotify_fd >= 0) {
+		char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+		ssize_t len;
+		while ((len = read(inotify_fd, buf, sizeof(buf))) > 0) {
+			for (char * p = buf; p < buf + len; ) {
+				struct inotify_event * ev = (struct inotify_event *) p;
+				if (ev->len && strcmp(ev->name, watched_name) == 0) modified = 1;
+				p += sizeof(struct inotify_event) + ev->len;
+			}
+		}
+	}
+	if (!modified && seen_version == computers_version) return 0;
+
+	long start = monotonicUs();
+	if (modified) computersRefresh();
+	int cnt = recalc(changed, max);
+
+	long t = monotonicUs() - start;
+	status_metrics.cnt_refresh++;
+	status_metrics.last_refresh_us = t;
+	status_metrics.total_refresh_us += t;
+	if (t > status_metrics.max_refresh_us) status_metrics.max_refresh_us = t;
+	printf("status refresh: %li us, %i changed\n", t, cnt);
+	fflush(stdout);
+	return cnt;
+}
+
+void statusClose() {
+	if (inotify_fd >= 0) close(inotify_fd);
+	inotify_fd = -1;
+}
@@ -0,0 +1,36 @@
+#ifndef STATUS_H
+#define STATUS_H
+
+// At least the number of icons in layout.txt. Only the icons of one page have objects,
+// so this costs an int per slot.
+#define MAX_COMP 1024
+
+/*
+0 - No computer							(grey)
+1 - No sensor							(yellow)
+2 - Computer not avaliable right now	(red)
+3 - Computer is avaliable				(green)
+*/
+extern int c_status[MAX_COMP];
+
+struct StatusMetrics {
+	int cnt_refresh;
+	long last_refresh_us, max_refresh_us, total_refresh_us;
+};
+
+extern struct StatusMetrics status_metrics;
+
+// Loads computers.txt (if it wasn't loaded yet), fills c_status[] and starts watching the file.
+// Returns -1 if the file can't be read.
+int statusInit(const char * path);
+
+// Non-blocking. Reloads computers.txt if it was changed on disk and recalculates c_status[].
+// Ids of the changed slots are written to 'changed' (at most 'max'). Returns their number.
+int statusPoll(int * changed, int max);
+
+void statusClose();
+
+// Microseconds from CLOCK_MONOTONIC
+long monotonicUs();
+
+#endif
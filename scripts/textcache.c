@@ -0,0 +1,68 @@
+#include <string.h>
+
+#include "textcache.h"
+#include "render.h"
+
+struct TextRun text_runs[TEXT_CACHE_SIZE];
+struct TextCacheStats text_cache_stats;
+
+int cnt_runs = 0, cnt_pending = 0;
+
+// FNV-1a
+unsigned int textHash(int font, int size, const char * s, int len) {
+	unsigned int h = 2166136261u;
+	h = (h ^ font) * 16777619u;
+	h = (h ^ size) * 16777619u;
+	for (int i = 0; i < len; i++) h = (h ^ (unsigned char) s[i]) * 16777619u;
+	return h;
+}
+
+int textCacheFind(int font, int size, const char * s, int len) {
+	text_cache_stats.lookups++;
+	unsigned int i = textHash(font, size, s, len) & (TEXT_CACHE_SIZE - 1);
+	while (text_runs[i].used) {
+		struct TextRun * run = &text_runs[i];
+		if (run->font == font && run->size == size && run->len == len && memcmp(run->s, s, len) == 0) {
+			text_cache_stats.hits++;
+			return i;
+		}
+		i = (i + 1) & (TEXT_CACHE_SIZE - 1);
+	}
+
+	// Keep some free slots so the probes stay short
+	if (cnt_runs >= TEXT_CACHE_SIZE * 3 / 4 || len > MAX_TEXT_LEN) {
+		text_cache_stats.full++;
+		return -1;
+	}
+
+	struct TextRun * run = &text_runs[i];
+	run->used = 1;
+	run->font = font;
+	run->size = size;
+	run->len = len;
+	memcpy(run->s, s, len);
+	run->s[len] = 0;
+	run->handle = -1;
+	render->textBounds(font, size, 0, 0, s, len, run->bounds);
+	cnt_runs++;
+	cnt_pending++;
+	return i;
+}
+
+void textCachePrepare() {
+	if (cnt_pending == 0) return;
+	for (int i = 0; i < TEXT_CACHE_SIZE; i++) {
+		struct TextRun * run = &text_runs[i];
+		if (!run->used || run->handle != -1) continue;
+		run->handle = -2;
+		if (render->prepareText) run->handle = render->prepareText(run->font, run->size, run->s, run->len);
+		if (run->handle < 0) {
+			run->handle = -2;
+			text_cache_stats.failed++;
+		} else {
+			text_cache_stats.prepared++;
+		}
+	}
+	cnt_pending = 0;
+}
+
@@ -0,0 +1,35 @@
+#ifndef TEXTCACHE_H
+#define TEXTCACHE_H
+
+#include "ui.h"
+
+// Must be a power of 2
+#define TEXT_CACHE_SIZE 256
+
+// A string laid out once by the render backend and kept in its text atlas
+struct TextRun {
+	int used;
+	int font, size, len;
+	char s[MAX_TEXT_LEN + 1];
+
+	int handle;			// from render->prepareText(), -1 until prepared, -2 if it didn't fit
+	float bounds[4];	// relative to the left end of the baseline
+};
+
+struct TextCacheStats {
+	long lookups, hits;
+	long prepared, failed;	// render->prepareText() calls
+	long full;				// strings that didn't get an entry
+	long drawn_cached, drawn_direct;	// drawText() calls
+};
+
+extern struct TextRun text_runs[TEXT_CACHE_SIZE];
+extern struct TextCacheStats text_cache_stats;
+
+// Index of the run of 's' in 'text_runs', the run is added if it's new. -1 if the cache is full.
+int textCacheFind(int font, int size, const char * s, int len);
+// Lays out the runs added since the last call. Must not be called between
+// render->beginFrame() and render->endFrame().
+void textCachePrepare();
+
+#endif
@@ -0,0 +1,223 @@
+#include <pigpio.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "calib.h"
+#include "touch.h"
+#include "touchfilter.h"
+#include "touchspi.h"
+#include "spsc.h"
+#include "status.h"
+#include "trace.h"
+
+// Samples without touch before the next touch can be registered
+#define CYCLES_TO_NEXT_TOUCH 4
+
+static int handle = -1;
+static int width, height;
+static int irq = -1;
+static struct Spsc events;
+
+static pthread_t thread;
+static pthread_mutex_t pen_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pen_cond = PTHREAD_COND_INITIALIZER;
+static int pen_down = 0;
+static volatile int running = 0;
+
+static struct TouchFilter filter;
+static int touch_down = 0;
+static FILE * trace = NULL;
+// Number of the current touch and if the last sample was on the screen, for the trace
+static int touches = 0;
+static int on_screen = 0;
+
+// Calibration used by the touch thread is cal[cal_cur], the other one is written by touchSetCalibration()
+static struct Calibration cal[2];
+static volatile int cal_cur = 0;
+
+// Raw readings of the last TOUCH_WINDOW samples, averaged into TouchEvent.rx/ry
+static int raw_x[TOUCH_WINDOW], raw_y[TOUCH_WINDOW];
+static int raw_pos = 0;
+static long raw_sum_x = 0, raw_sum_y = 0;
+
+// Pen state by pressure, TOUCH_RT_DOWN/TOUCH_RT_UP
+static int pressed = 0;
+
+static void resetFilter() {
+	touchFilterReset(&filter);
+	pressed = 0;
+	for (int i = 0; i < TOUCH_WINDOW; i++) raw_x[i] = raw_y[i] = 0;
+	raw_pos = 0;
+	raw_sum_x = raw_sum_y = 0;
+}
+
+// Adds a sample, pushes an event once the last samples are close to each other
+static void sample(int sx, int sy, int rx, int ry) {
+	int x, y;
+	if (trace) fprintf(trace, "%i %i\n", sx, sy);
+	if (sx < width && !on_screen) {
+		touches++;
+		traceEvent(TRACE_PEN_DOWN, touches);
+	}
+	on_screen = sx < width;
+
+	raw_sum_x += rx - raw_x[raw_pos];
+	raw_sum_y += ry - raw_y[raw_pos];
+	raw_x[raw_pos] = rx;
+	raw_y[raw_pos] = ry;
+	raw_pos = raw_pos + 1 == TOUCH_WINDOW ? 0 : raw_pos + 1;
+
+	if (touchFilterAdd(&filter, sx, sy, &x, &y)) {
+		if (touch_down == 0) {
+			struct TouchEvent ev;
+			ev.x = x;
+			ev.y = y;
+			ev.rx = raw_sum_x / TOUCH_WINDOW;
+			ev.ry = raw_sum_y / TOUCH_WINDOW;
+			ev.t = monotonicUs();
+			if (!spscPush(&events, &ev)) fprintf(stderr, "Touch queue is full\n");
+			else traceEvent(TRACE_ACCEPT, touches);
+		}
+		touch_down = CYCLES_TO_NEXT_TOUCH - 1;
+	} else {
+		if (touch_down > 0) {
+			touch_down--;
+		}
+	}
+}
+
+static void sampleRaw(int rx, int ry) {
+	int x, y;
+	calibApply(&cal[cal_cur], rx, ry, &x, &y);
+	// Without a touch the readings land off the screen
+	if (x < 0 || x >= width) x = width;
+	sample(x, y, rx, ry);
+}
+
+static void sampleRelease() {
+	sample(width, height, 0, 0);
+}
+
+// X, Y and the pressure come in one SPI transfer (see touchspi.c)
+static void readSample() {
+	struct TouchRaw r;
+	if (touchSpiRead(handle, &r) < 0) {
+		sampleRelease();
+		return;
+	}
+	if (TOUCH_PRESSURE) {
+		// Hysteresis, so a light press doesn't flicker at the threshold
+		int rt = touchResistance(&r);
+		pressed = rt <= (pressed ? TOUCH_RT_UP : TOUCH_RT_DOWN);
+		if (!pressed) {
+			sampleRelease();
+			return;
+		}
+	}
+	sampleRaw(r.x, r.y);
+}
+
+// Called by pigpio's alert thread
+static void penIrq(int gpio, int level, uint32_t tick, void * data) {
+	if (level > 1) return;
+	pthread_mutex_lock(&pen_lock);
+	pen_down = level == 0;
+	pthread_cond_signal(&pen_cond);
+	pthread_mutex_unlock(&pen_lock);
+}
+
+static void * touchLoop(void * arg) {
+	resetFilter();
+	while (running) {
+		if (irq >= 0) {
+			pthread_mutex_lock(&pen_lock);
+			while (!pen_down && running) {
+				pthread_cond_wait(&pen_cond, &pen_lock);
+			}
+			pthread_mutex_unlock(&pen_lock);
+			if (!running) break;
+
+			// Sample while the pen is down, then let the filter see the release
+			while (running && gpioRead(irq) == 0) {
+				readSample();
+				gpioDelay(1000);
+			}
+			for (int i = 0; i < CYCLES_TO_NEXT_TOUCH; i++) sampleRelease();
+			resetFilter();
+
+			pthread_mutex_lock(&pen_lock);
+			pen_down = gpioRead(irq) == 0;
+			pthread_mutex_unlock(&pen_lock);
+		} else {
+			readSample();
+			gpioDelay(1000);
+		}
+	}
+	return NULL;
+}
+
+int touchInit(int w, int h) {
+	width = w;
+	height = h;
+	cal[0] = calib_default;
+	cal_cur = 0;
+
+	struct TouchFilterParams p = { TOUCH_WINDOW, TOUCH_SPREAD, w };
+	touchFilterInit(&filter, p);
+
+	// Raw samples can be recorded for touchbench
+	char * path = getenv("TOUCH_TRACE");
+	if (path && (trace = fopen(path, "w")) == NULL) perror(path);
+	handle = spiOpen(0, TOUCH_SPI_SPEED, 0);
+	if (handle < 0) {
+		printf("SPI open error");
+		return -1;
+	}
+
+	spscInit(&events, TOUCH_QUEUE, sizeof(struct TouchEvent));
+	irq = TOUCH_IRQ_PIN;
+	if (irq >= 0) {
+		gpioSetMode(irq, PI_INPUT);
+		gpioSetPullUpDown(irq, PI_PUD_UP);
+		if (gpioSetAlertFuncEx(irq, penIrq, NULL) != 0) {
+			fprintf(stderr, "Can't watch PENIRQ, touch will be polled\n");
+			irq = -1;
+		} else {
+			pen_down = gpioRead(irq) == 0;
+		}
+	}
+
+	running = 1;
+	if (pthread_create(&thread, NULL, touchLoop, NULL) != 0) {
+		perror("pthread_create");
+		running = 0;
+		return -1;
+	}
+	return 0;
+}
+
+int touchPoll(struct TouchEvent * ev) {
+	if (!running) return 0;
+	return spscPop(&events, ev);
+}
+
+void touchSetCalibration(const struct Calibration * c) {
+	int next = !cal_cur;
+	cal[next] = *c;
+	__sync_synchronize();
+	cal_cur = next;
+}
+
+void touchClose() {
+	if (!running) return;
+	pthread_mutex_lock(&pen_lock);
+	running = 0;
+	pthread_cond_signal(&pen_cond);
+	pthread_mutex_unlock(&pen_lock);
+	pthread_join(thread, NULL);
+	if (irq >= 0) gpioSetAlertFuncEx(irq, NULL, NULL);
+	spiClose(handle);
+	if (trace) fclose(trace);
+	trace = NULL;
+}
@@ -0,0 +1,45 @@
+#ifndef TOUCH_H
+#define TOUCH_H
+
+// XPT2046 PENIRQ, active low. -1 makes the touch thread poll all the time.
+#define TOUCH_IRQ_PIN 17
+#define TOUCH_SPI_SPEED 1000000
+#define TOUCH_QUEUE 32
+// Pen is down when the touch resistance (see touchspi.h) drops below TOUCH_RT_DOWN ohms
+// and up again when it rises above TOUCH_RT_UP. 0 leaves it to the coordinates alone.
+#define TOUCH_PRESSURE 1
+#define TOUCH_RT_DOWN 1500
+#define TOUCH_RT_UP 2500
+
+// Touch is registered when the last TOUCH_WINDOW samples are within TOUCH_SPREAD (Manhattan distance).
+// Without pressure the window has to be long to skip the readings of a pen that is barely down.
+#if TOUCH_PRESSURE
+#define TOUCH_WINDOW 5
+#define TOUCH_SPREAD 30
+#else
+#define TOUCH_WINDOW 40
+#define TOUCH_SPREAD 70
+#endif
+
+#include "calib.h"
+
+struct TouchEvent {
+	int x, y;
+	int rx, ry; // average raw readings, for the calibration
+	long t; // monotonicUs() of the last sample
+};
+
+// Opens SPI and starts the touch thread. gpioInitialise() must be called before.
+// If TOUCH_TRACE is set, samples are written to that file ("x y" per line, calibrated).
+int touchInit(int width, int height);
+
+// Can be called any time after touchInit(), the touch thread picks it up with the next sample.
+// Until then the map of calib_default is used.
+void touchSetCalibration(const struct Calibration * cal);
+
+// Non-blocking. Returns 1 and fills 'ev' if there was a touch.
+int touchPoll(struct TouchEvent * ev);
+
+void touchClose();
+
+#endif
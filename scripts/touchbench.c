@@ -0,0 +1,158 @@
+/*
+	Replays a touch trace through the old O(N^2) filter and through touchfilter.c,
+	checks that they accept the same samples with the same coordinates and prints the timings.
+
+	./touchbench [trace]
+
+	A trace is "x y" per line, as written by the touch thread when TOUCH_TRACE is set.
+	Without a trace a synthetic one (idle, taps, drags, noise) is generated.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "touch.h"
+#include "touchfilter.h"
+
+#define WIDTH 800
+#define HEIGHT 480
+#define REPEAT 20
+
+int * xs, * ys;
+int cnt = 0, cap = 0;
+
+void addSample(int x, int y) {
+	if (cnt == cap) {
+		cap = cap ? cap * 2 : 4096;
+		xs = (int *) realloc(xs, sizeof(int) * cap);
+		ys = (int *) realloc(ys, sizeof(int) * cap);
+	}
+	xs[cnt] = x;
+	ys[cnt] = y;
+	cnt++;
+}
+
+unsigned int seed = 12345;
+int rnd(int n) {
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16) % n;
+}
+
+void generate() {
+	for (int k = 0; k < 2000; k++) {
+		int idle = 50 + rnd(500);
+		for (int i = 0; i < idle; i++) addSample(844, -52);
+		int x = rnd(WIDTH), y = rnd(HEIGHT);
+		int len = 10 + rnd(300), noise = 5 + rnd(60), drag = rnd(3);
+		for (int i = 0; i < len; i++) {
+			if (drag) {
+				x += rnd(7) - 3;
+				y += rnd(7) - 3;
+			}
+			int sx = x + rnd(noise) - noise / 2, sy = y + rnd(noise) - noise / 2;
+			// Spikes the controller gives when the pen is pressed lightly
+			if (rnd(50) == 0) sx = 844;
+			addSample(sx, sy);
+		}
+	}
+}
+
+// The filter main.c used before touchfilter.c
+#define CNT_READS TOUCH_WINDOW
+int touchData[CNT_READS][2];
+
+int dist(int x1, int y1, int x2, int y2) {
+	return abs(x1 - x2) + abs(y1 - y2);
+}
+
+int oldFilter(int sx, int sy, int * ox, int * oy) {
+	for (int i = CNT_READS - 1; i > 0; i--) {
+		touchData[i][0] = touchData[i - 1][0];
+		touchData[i][1] = touchData[i - 1][1];
+	}
+	touchData[0][0] = sx;
+	touchData[0][1] = sy;
+	int g = 1;
+	for (int i = 0; i < CNT_READS; i++) {
+		if (touchData[i][0] >= WIDTH) g = 0;
+		if (!g) break;
+		for (int j = i + 1; j < CNT_READS; j++) {
+			if (dist(touchData[i][0], touchData[i][1], touchData[j][0], touchData[j][1]) > TOUCH_SPREAD) {
+				g = 0;
+				break;
+			}
+		}
+	}
+	if (g) {
+		int x = 0, y = 0;
+		for (int i = 0; i < CNT_READS; i++) {
+			x += touchData[i][0];
+			y += touchData[i][1];
+		}
+		*ox = x / CNT_READS;
+		*oy = y / CNT_READS;
+	}
+	return g;
+}
+
+long nowNs() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+int main(int argc, char ** argv) {
+	if (argc > 1) {
+		FILE * f = fopen(argv[1], "r");
+		if (f == NULL) {
+			perror(argv[1]);
+			return 1;
+		}
+		int x, y;
+		while (fscanf(f, "%d %d", &x, &y) == 2) addSample(x, y);
+		fclose(f);
+	} else {
+		generate();
+	}
+	printf("samples: %i\n", cnt);
+
+	char * old_res = (char *) malloc(cnt);
+	int * old_xy = (int *) malloc(sizeof(int) * 2 * cnt);
+	long sum = 0;
+
+	long start = nowNs();
+	for (int r = 0; r < REPEAT; r++) {
+		for (int i = 0; i < CNT_READS; i++) touchData[i][0] = touchData[i][1] = WIDTH;
+		for (int i = 0; i < cnt; i++) {
+			old_res[i] = oldFilter(xs[i], ys[i], &old_xy[2 * i], &old_xy[2 * i + 1]);
+			sum += old_res[i];
+		}
+	}
+	long t_old = nowNs() - start;
+
+	struct TouchFilter filter;
+	struct TouchFilterParams p = { TOUCH_WINDOW, TOUCH_SPREAD, WIDTH };
+	int mismatch = 0, accepted = 0;
+
+	start = nowNs();
+	for (int r = 0; r < REPEAT; r++) {
+		touchFilterInit(&filter, p);
+		for (int i = 0; i < cnt; i++) {
+			int x, y;
+			int g = touchFilterAdd(&filter, xs[i], ys[i], &x, &y);
+			sum += g;
+			if (r == 0) {
+				accepted += g;
+				if (g != old_res[i] || (g && (x != old_xy[2 * i] || y != old_xy[2 * i + 1]))) mismatch++;
+			}
+		}
+	}
+	long t_new = nowNs() - start;
+
+	double n = (double) cnt * REPEAT;
+	printf("accepted: %i, mismatches: %i (checksum %li)\n", accepted, mismatch, sum);
+	printf("old filter:       %8.1f ns/sample\n", t_old / n);
+	printf("streaming filter: %8.1f ns/sample\n", t_new / n);
+	printf("speedup: %.1fx\n", (double) t_old / t_new);
+	return mismatch != 0;
+}
@@ -0,0 +1,89 @@
+#include "touchfilter.h"
+
+#define QMAXU 0
+#define QMINU 1
+#define QMAXV 2
+#define QMINV 3
+
+#define QMASK (TOUCH_FILTER_MAX_WINDOW - 1)
+
+// 1 if 'old' can't be the answer of queue 'q' anymore once 'val' is added
+static int dominated(int q, int old, int val) {
+	if (q == QMAXU || q == QMAXV) return old <= val;
+	return old >= val;
+}
+
+static int front(struct TouchFilter * f, int q) {
+	return f->qv[q][f->qh[q] & QMASK];
+}
+
+void touchFilterInit(struct TouchFilter * f, struct TouchFilterParams p) {
+	if (p.window < 1) p.window = 1;
+	if (p.window > TOUCH_FILTER_MAX_WINDOW) p.window = TOUCH_FILTER_MAX_WINDOW;
+	f->p = p;
+	touchFilterReset(f);
+}
+
+void touchFilterReset(struct TouchFilter * f) {
+	f->n = 0;
+	f->pos = 0;
+	for (int q = 0; q < 4; q++) f->qh[q] = f->qt[q] = 0;
+	f->sum_x = f->sum_y = 0;
+	f->invalid = 0;
+	for (int i = 0; i < f->p.window; i++) {
+		int x, y;
+		touchFilterAdd(f, f->p.limit, f->p.limit, &x, &y);
+	}
+}
+
+int touchFilterAdd(struct TouchFilter * f, int sx, int sy, int * x, int * y) {
+	int w = f->p.window;
+	int pos = f->pos;
+
+	if (f->n >= (unsigned long long) w) {
+		// Sample number n - w leaves the window, it was in the same slot
+		unsigned long long old = f->n - w;
+		f->sum_x -= f->xs[pos];
+		f->sum_y -= f->ys[pos];
+		if (f->xs[pos] >= f->p.limit) f->invalid--;
+		for (int q = 0; q < 4 && w > TOUCH_FILTER_SCAN_WINDOW; q++) {
+			if (f->qh[q] != f->qt[q] && f->qn[q][f->qh[q] & QMASK] == old) f->qh[q]++;
+		}
+	}
+
+	f->xs[pos] = sx;
+	f->ys[pos] = sy;
+	f->sum_x += sx;
+	f->sum_y += sy;
+	if (sx >= f->p.limit) f->invalid++;
+	for (int q = 0; q < 4 && w > TOUCH_FILTER_SCAN_WINDOW; q++) {
+		int val = q < QMAXV ? sx + sy : sx - sy;
+		while (f->qh[q] != f->qt[q] && dominated(q, f->qv[q][(f->qt[q] - 1) & QMASK], val)) f->qt[q]--;
+		f->qn[q][f->qt[q] & QMASK] = f->n;
+		f->qv[q][f->qt[q] & QMASK] = val;
+		f->qt[q]++;
+	}
+	f->n++;
+	f->pos = pos + 1 == w ? 0 : pos + 1;
+
+	if (f->invalid) return 0;
+	if (w <= TOUCH_FILTER_SCAN_WINDOW) {
+		int max_u = f->xs[0] + f->ys[0], min_u = max_u;
+		int max_v = f->xs[0] - f->ys[0], min_v = max_v;
+		for (int i = 1; i < w; i++) {
+			int u = f->xs[i] + f->ys[i], v = f->xs[i] - f->ys[i];
+			if (u > max_u) max_u = u;
+			if (u < min_u) min_u = u;
+			if (v > max_v) max_v = v;
+			if (v < min_v) min_v = v;
+		}
+		if (max_u - min_u > f->p.spread || max_v - min_v > f->p.spread) return 0;
+	} else {
+		if (front(f, QMAXU) - front(f, QMINU) > f->p.spread) return 0;
+		if (front(f, QMAXV) - front(f, QMINV) > f->p.spread) return 0;
+	}
+
+	*x = f->sum_x / w;
+	*y = f->sum_y / w;
+	return 1;
+}
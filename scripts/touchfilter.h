@@ -0,0 +1,41 @@
+#ifndef TOUCHFILTER_H
+#define TOUCHFILTER_H
+
+#define TOUCH_FILTER_MAX_WINDOW 256 // power of two
+// Up to this window the ranges are taken over the whole ring, the queues cost more than that
+#define TOUCH_FILTER_SCAN_WINDOW 8
+
+struct TouchFilterParams {
+	int window;	// number of the last samples that have to agree
+	int spread;	// max Manhattan distance between any two of them
+	int limit;	// samples with x >= limit mean "no touch"
+};
+
+/*
+	Keeps the last 'window' samples in a ring. The max Manhattan distance between two points
+	is max(range(x + y), range(x - y)), so instead of comparing all pairs it keeps
+	running min/max of x + y and x - y in monotonic queues. O(1) amortized per sample.
+	Windows up to TOUCH_FILTER_SCAN_WINDOW just scan the ring for them.
+*/
+struct TouchFilter {
+	struct TouchFilterParams p;
+	int xs[TOUCH_FILTER_MAX_WINDOW], ys[TOUCH_FILTER_MAX_WINDOW];
+	int pos; // slot of the next sample
+	unsigned long long n; // number of samples added since the reset
+	int invalid; // samples in the window with x >= limit
+	long sum_x, sum_y;
+
+	// Monotonic queues of (sample number, value): max/min of u = x + y and v = x - y
+	unsigned long long qn[4][TOUCH_FILTER_MAX_WINDOW];
+	int qv[4][TOUCH_FILTER_MAX_WINDOW];
+	unsigned int qh[4], qt[4];
+};
+
+void touchFilterInit(struct TouchFilter * f, struct TouchFilterParams p);
+// Window is filled with "no touch" samples
+void touchFilterReset(struct TouchFilter * f);
+
+// Returns 1 if the window is stable, 'x' and 'y' get the average of the window then
+int touchFilterAdd(struct TouchFilter * f, int sx, int sy, int * x, int * y);
+
+#endif
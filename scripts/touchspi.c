@@ -0,0 +1,44 @@
+#include <limits.h>
+#include <pigpio.h>
+
+#include "touchspi.h"
+
+// X TOUCH_CONVERSIONS times, Y TOUCH_CONVERSIONS times, Z1, Z2
+#define CONVERSIONS (2 * TOUCH_CONVERSIONS + 2)
+#define FRAME_LEN (2 * CONVERSIONS + 1)
+
+// The result of conversion i
+static int result(const char * buf, int i) {
+	return ((buf[2 * i + 1] & 0x7f) << 8) | (unsigned char) buf[2 * i + 2];
+}
+
+int touchSpiRead(int handle, struct TouchRaw * r) {
+	char buf[FRAME_LEN];
+	for (int i = 0; i < FRAME_LEN; i++) buf[i] = 0;
+	for (int i = 0; i < TOUCH_CONVERSIONS; i++) {
+		buf[2 * i] = XPT_X;
+		buf[2 * (TOUCH_CONVERSIONS + i)] = XPT_Y;
+	}
+	buf[2 * (2 * TOUCH_CONVERSIONS)] = XPT_Z1;
+	buf[2 * (2 * TOUCH_CONVERSIONS + 1)] = XPT_Z2;
+
+	int res = spiXfer(handle, buf, buf, FRAME_LEN);
+	if (res < 0) return res;
+
+	int x = 0, y = 0;
+	for (int i = 1; i < TOUCH_CONVERSIONS; i++) {
+		x += result(buf, i);
+		y += result(buf, TOUCH_CONVERSIONS + i);
+	}
+	r->x = x / (TOUCH_CONVERSIONS - 1);
+	r->y = y / (TOUCH_CONVERSIONS - 1);
+	r->z1 = result(buf, 2 * TOUCH_CONVERSIONS);
+	r->z2 = result(buf, 2 * TOUCH_CONVERSIONS + 1);
+	return res;
+}
+
+int touchResistance(const struct TouchRaw * r) {
+	long x = r->x >> 3, z1 = r->z1 >> 3, z2 = r->z2 >> 3;
+	if (z1 < TOUCH_Z_MIN || z2 <= z1) return INT_MAX;
+	return (int) (TOUCH_X_PLATE * x * (z2 - z1) / (4096 * z1));
+}
@@ -0,0 +1,36 @@
+#ifndef TOUCHSPI_H
+#define TOUCHSPI_H
+
+// XPT2046 control bytes: start, channel, 12 bit, single ended, power down between conversions
+#define XPT_X 0xD4
+#define XPT_Y 0x94
+#define XPT_Z1 0xB4
+#define XPT_Z2 0xC4
+
+// Conversions of X and Y per sample, the first one of each is dropped while the input settles
+#define TOUCH_CONVERSIONS 3
+
+// Resistance of the X plate of the panel in ohms, scales touchResistance()
+#define TOUCH_X_PLATE 400
+// Z1 (12 bit) below this is no touch at all
+#define TOUCH_Z_MIN 40
+
+// 15 bit readings like ((buf[1] & 0x7f) << 8) | buf[2] of a single 3 byte transfer
+struct TouchRaw {
+	int x, y, z1, z2;
+};
+
+/*
+	Reads a whole sample with one spiXfer(). Every conversion returns its result in the
+	16 clocks after the control byte, so the next control byte is sent with the last byte
+	of the previous result: n conversions take 2n + 1 bytes instead of 3n and one syscall
+	instead of n.
+	Returns the result of spiXfer().
+*/
+int touchSpiRead(int handle, struct TouchRaw * r);
+
+// Touch resistance in ohms from the datasheet: X plate * X / 4096 * (Z2 / Z1 - 1).
+// The harder the press, the lower. INT_MAX without a touch.
+int touchResistance(const struct TouchRaw * r);
+
+#endif
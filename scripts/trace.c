@@ -0,0 +1,177 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "status.h"
+#include "trace.h"
+
+#define TRACE_MASK (TRACE_SIZE - 1)
+
+static struct TraceRecord ring[TRACE_SIZE];
+static unsigned long head = 0;
+static volatile sig_atomic_t dump_requested = 0;
+
+static const char * type_names[TRACE_TYPES] = {
+	"pen_down", "accept", "touch", "scene", "draw_start", "draw_end", "upload"
+};
+
+void traceEvent(int type, int data) {
+	unsigned long i = __sync_fetch_and_add(&head, 1);
+	struct TraceRecord * r = &ring[i & TRACE_MASK];
+	r->seq = 0;
+	__sync_synchronize();
+	r->t = monotonicUs();
+	r->type = type;
+	r->data = data;
+	__sync_synchronize();
+	r->seq = i + 1;
+}
+
+static void onSignal(int sig) {
+	dump_requested = 1;
+}
+
+void traceInit() {
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = onSignal;
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags = SA_RESTART;
+	sigaction(SIGUSR1, &sa, NULL);
+}
+
+int traceDumpRequested() {
+	if (!dump_requested) return 0;
+	dump_requested = 0;
+	return 1;
+}
+
+// LATENCIES
+
+enum {
+	STAGE_PEN_ACCEPT,
+	STAGE_ACCEPT_TOUCH,
+	STAGE_TOUCH_DRAW,
+	STAGE_DRAW,
+	STAGE_UPLOAD,
+	STAGE_TOUCH_PHOTON,
+	STAGE_SCENE_PHOTON,
+	STAGES
+};
+
+static const char * stage_names[STAGES] = {
+	"pen down -> accept", "accept -> touch", "touch -> draw", "draw", "upload",
+	"pen down -> screen", "scene -> screen"
+};
+
+static struct TraceRecord copy[TRACE_SIZE];
+static long stage_us[STAGES][TRACE_SIZE];
+static int cnt_stage[STAGES];
+
+static void addStage(int stage, long us) {
+	if (cnt_stage[stage] < TRACE_SIZE) stage_us[stage][cnt_stage[stage]++] = us;
+}
+
+static int cmpLong(const void * a, const void * b) {
+	long x = *(const long *) a, y = *(const long *) b;
+	return x < y ? -1 : x > y;
+}
+
+// Follows every touch from the pen to the first frame drawn after it
+static void measure(struct TraceRecord * recs, int cnt) {
+	long pen = -1, accept = -1, touch = -1, scene = -1;
+	long draw_start = -1, draw_end = -1;
+	int pen_touch = -1;
+	// Set when a frame starts: it shows the touch / the scene
+	long frame_pen = -1, frame_scene = -1;
+
+	for (int s = 0; s < STAGES; s++) cnt_stage[s] = 0;
+	for (int i = 0; i < cnt; i++) {
+		struct TraceRecord * r = &recs[i];
+		switch (r->type) {
+		case TRACE_PEN_DOWN:
+			pen = r->t;
+			pen_touch = r->data;
+			break;
+		case TRACE_ACCEPT:
+			if (pen >= 0 && r->data == pen_touch) {
+				addStage(STAGE_PEN_ACCEPT, r->t - pen);
+				accept = r->t;
+			}
+			break;
+		case TRACE_TOUCH:
+			if (accept >= 0) {
+				addStage(STAGE_ACCEPT_TOUCH, r->t - accept);
+				touch = r->t;
+				accept = -1;
+			}
+			break;
+		case TRACE_SCENE:
+			scene = r->t;
+			break;
+		case TRACE_DRAW_START:
+			draw_start = r->t;
+			if (touch >= 0) {
+				addStage(STAGE_TOUCH_DRAW, r->t - touch);
+				frame_pen = pen;
+				touch = -1;
+			}
+			frame_scene = scene;
+			scene = -1;
+			break;
+		case TRACE_DRAW_END:
+			if (draw_start >= 0) addStage(STAGE_DRAW, r->t - draw_start);
+			draw_end = r->t;
+			draw_start = -1;
+			break;
+		case TRACE_UPLOAD:
+			if (draw_end >= 0) addStage(STAGE_UPLOAD, r->t - draw_end);
+			if (frame_pen >= 0) addStage(STAGE_TOUCH_PHOTON, r->t - frame_pen);
+			if (frame_scene >= 0) addStage(STAGE_SCENE_PHOTON, r->t - frame_scene);
+			draw_end = frame_pen = frame_scene = -1;
+			break;
+		}
+	}
+}
+
+static long percentile(long * v, int cnt, int p) {
+	return v[(long) (cnt - 1) * p / 100];
+}
+// LATENCIES
+
+void traceDump(const char * path, FILE * report) {
+	// Records that are being written are skipped, the writers don't wait for the dump
+	unsigned long end = head;
+	unsigned long start = end > TRACE_SIZE ? end - TRACE_SIZE : 0;
+	int cnt = 0;
+	for (unsigned long i = start; i < end; i++) {
+		struct TraceRecord * r = &ring[i & TRACE_MASK];
+		if (r->seq != i + 1) continue;
+		copy[cnt] = *r;
+		__sync_synchronize();
+		if (r->seq == i + 1) cnt++;
+	}
+
+	FILE * f = fopen(path, "w");
+	if (f == NULL) {
+		perror(path);
+	} else {
+		for (int i = 0; i < cnt; i++) {
+			fprintf(f, "%ld %s %d\n", copy[i].t, type_names[copy[i].type], copy[i].data);
+		}
+		fclose(f);
+	}
+
+	measure(copy, cnt);
+	fprintf(report, "trace: %d records (%lu since start) in %s\n", cnt, end, path);
+	fprintf(report, "%-20s %6s %8s %8s %8s %8s\n", "us", "count", "p50", "p90", "p99", "max");
+	for (int s = 0; s < STAGES; s++) {
+		int n = cnt_stage[s];
+		if (n == 0) continue;
+		qsort(stage_us[s], n, sizeof(long), cmpLong);
+		fprintf(report, "%-20s %6d %8ld %8ld %8ld %8ld\n", stage_names[s], n, percentile(stage_us[s], n, 50),
+			percentile(stage_us[s], n, 90), percentile(stage_us[s], n, 99), stage_us[s][n - 1]);
+	}
+	fflush(report);
+}
@@ -0,0 +1,38 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+
+// Records kept, the oldest are overwritten. Power of two.
+#define TRACE_SIZE 8192
+// Written by traceDump(), one "us type data" line per record
+#define TRACE_FILE "trace.txt"
+
+enum TraceType {
+	TRACE_PEN_DOWN,		// first pressed sample of a touch (touch thread), data: touch number
+	TRACE_ACCEPT,		// touch event queued (touch thread), data: touch number
+	TRACE_TOUCH,		// registerTouch(), data: index of the touched object or -1
+	TRACE_SCENE,		// changeScene(), data: scene
+	TRACE_DRAW_START,	// render thread, after the snapshot
+	TRACE_DRAW_END,		// before render->endFrame()
+	TRACE_UPLOAD,		// after render->endFrame(): the frame is on the screen
+	TRACE_TYPES
+};
+
+struct TraceRecord {
+	long t;	// monotonicUs()
+	int type, data;
+	volatile unsigned long seq; // number of the record + 1, 0 while it is written
+};
+
+// Lock-free, can be called from any thread. A few ns: no syscall, no formatting.
+void traceEvent(int type, int data);
+
+// SIGUSR1 asks for a dump. Call after gpioInitialise(), pigpio takes SIGUSR1 for itself.
+void traceInit();
+// Set by SIGUSR1, cleared by the call
+int traceDumpRequested();
+// Writes the records to 'path' and the latencies between them (percentiles) to 'report'
+void traceDump(const char * path, FILE * report);
+
+#endif
@@ -0,0 +1,614 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ui.h"
+#include "render.h"
+#include "textcache.h"
+#include "status.h"
+#include "trace.h"
+
+struct RenderBackend * render = NULL;
+int width, height;
+int current_scene = 0;
+
+void addString(struct Text * text, char * s) {
+	int i = text->len;
+	while (i < text->max_len && s[i - text->len]) {
+		if (text->pswd) text->s[i] = '*';
+		else text->s[i] = s[i - text->len];
+		i++;
+	}
+	text->len = i;
+	text->s[i] = 0;
+	text->run = -1;
+	markDirty(text->owner);
+}
+
+void addChar(struct Text * text, char c) {
+	if (text->len == text->max_len) return;
+	if (text->pswd) text->s[text->len] = '*';
+	else text->s[text->len] = c;
+	text->len++;
+	text->s[text->len] = 0;
+	text->run = -1;
+	markDirty(text->owner);
+}
+
+void clearText(struct Text * text) {
+	text->len = 0;
+	text->s[0] = 0;
+	text->run = -1;
+	markDirty(text->owner);
+}
+
+// Remove last 'n' letters from 'text->s'
+void removeText(struct Text * text, int n) {
+	while (n-- && text->len > 0) {
+		text->s[text->len - 1] = 0;
+		text->len--;
+	}
+	text->run = -1;
+	markDirty(text->owner);
+}
+
+void removeChar(struct Text * text) {
+	removeText(text, 1);
+}
+
+int isTouched(struct Object * object, int x, int y) {
+	if (object->can_touch) {
+		int tx = object->tarea.x1 <= x && object->tarea.x2 >= x;
+		int ty = object->tarea.y1 <= y && object->tarea.y2 >= y;
+		return tx && ty;
+	}
+	return 0;
+}
+
+void setTouchArea(struct Object * object, int x1, int y1, int x2, int y2) {
+	invalidateTouchIndex();
+	object->can_touch = 1;
+	object->tarea.x1 = x1;
+	object->tarea.y1 = y1;
+	object->tarea.x2 = x2;
+	object->tarea.y2 = y2;
+}
+
+void defaultObject(struct Object * object) {
+	object->cnt_rects = object->cnt_boxes = object->cnt_texts = 0;
+	object->can_touch = object->has_focus = 0;
+	object->scene = object->id = object->priority = object->hide = 0;
+	object->dynamic = 0;
+	object->data = 0;
+	object->touch_event = -1;
+	object->dirty = 1;
+	object->drawn = 0;
+}
+
+void invalidateLayer(int scene);
+
+void markDirty(struct Object * object) {
+	object->dirty = 1;
+	if (!object->dynamic) invalidateLayer(object->scene);
+}
+
+// Hidden objects can't be touched either
+void setHidden(struct Object * object, int hide) {
+	if (object->can_touch != !hide) invalidateTouchIndex();
+	object->hide = hide;
+	object->can_touch = !hide;
+	markDirty(object);
+}
+
+void addColorRect(struct Object * object, int x1, int y1, int x2, int y2, int r, int g, int b, int a) {
+	int cnt_rects = object->cnt_rects;
+	object->rects[cnt_rects].x1 = x1;
+	object->rects[cnt_rects].y1 = y1;
+	object->rects[cnt_rects].x2 = x2;
+	object->rects[cnt_rects].y2 = y2;
+	object->rects[cnt_rects].r = r;
+	object->rects[cnt_rects].g = g;
+	object->rects[cnt_rects].b = b;
+	object->rects[cnt_rects].a = a;
+	object->rects[cnt_rects].hide = 0;
+	object->cnt_rects++;
+	object->dirty = 1;
+}
+
+void addRect(struct Object * object, int x1, int y1, int x2, int y2) {
+	addColorRect(object, x1, y1, x2, y2, 0, 0, 0, 255);
+}
+
+void addColorBox(struct Object * object, int x1, int y1, int x2, int y2, int r, int g, int b, int a, int w) {
+	int cnt_boxes = object->cnt_boxes;
+	object->boxes[cnt_boxes].x1 = x1;
+	object->boxes[cnt_boxes].y1 = y1;
+	object->boxes[cnt_boxes].x2 = x2;
+	object->boxes[cnt_boxes].y2 = y2;
+	object->boxes[cnt_boxes].r = r;
+	object->boxes[cnt_boxes].g = g;
+	object->boxes[cnt_boxes].b = b;
+	object->boxes[cnt_boxes].a = a;
+	object->boxes[cnt_boxes].w = w;
+	object->boxes[cnt_boxes].hide = 0;
+	object->cnt_boxes++;
+	object->dirty = 1;
+}
+
+void addBox(struct Object * object, int x1, int y1, int x2, int y2, int w) {
+	addColorBox(object, x1, y1, x2, y2, 0, 0, 0, 255, w);
+}
+
+struct Text* addColorText(struct Object * object, int x, int dx, int y, int dy, int font, int font_size, int r, int g, int b, int a, int max_len) {
+	int cnt_texts = object->cnt_texts;
+	object->texts[cnt_texts].x = x;
+	object->texts[cnt_texts].y = y;
+	object->texts[cnt_texts].dx = dx;
+	object->texts[cnt_texts].dy = dy;
+	object->texts[cnt_texts].font = font;
+	object->texts[cnt_texts].font_size = font_size;
+	object->texts[cnt_texts].r = r;
+	object->texts[cnt_texts].g = g;
+	object->texts[cnt_texts].b = b;
+	object->texts[cnt_texts].a = a;
+	object->texts[cnt_texts].hide = 0;
+	if (max_len > MAX_TEXT_LEN) max_len = MAX_TEXT_LEN;
+	object->texts[cnt_texts].s[0] = 0;
+	object->texts[cnt_texts].max_len = max_len;
+	object->texts[cnt_texts].len = 0;
+	object->texts[cnt_texts].pswd = 0;
+	object->texts[cnt_texts].dynamic = 0;
+	object->texts[cnt_texts].run = -1;
+	object->texts[cnt_texts].owner = object;
+	object->cnt_texts++;
+	object->dirty = 1;
+	return &object->texts[cnt_texts];
+}
+
+struct Text* addText(struct Object * object, int x, int dx, int y, int dy, int font, int font_size, int max_len) {
+	return addColorText(object, x, dx, y, dy, font, font_size, 0, 0, 0, 255, max_len);
+}
+
+struct Arena ui_arena;
+long last_frame_allocs = 0;
+
+// OBJECT LISTS
+// Every scene has its own list, objects shown in all scenes are in the overlay list.
+// Lists are sorted by priority, objects with the same priority keep the order they were added in.
+
+struct ObjectList scene_objects[MAX_SCENES];
+struct ObjectList overlay_objects;
+int cnt_objects = 0;
+
+// Current scene merged with the overlay: what is drawn and touched
+struct ObjectList draw_list;
+int draw_list_scene = -1, draw_list_version = 0, objects_version = 1;
+
+void listAppend(struct ObjectList * list, struct Object * object) {
+	if (list->cnt == list->cap) {
+		int cap = list->cap ? list->cap * 2 : 16;
+		list->items = (struct Object **) arenaGrow(&ui_arena, list->items,
+			sizeof(struct Object *) * list->cap, sizeof(struct Object *) * cap);
+		list->cap = cap;
+	}
+	list->items[list->cnt++] = object;
+}
+
+void listInsert(struct ObjectList * list, struct Object * object) {
+	listAppend(list, object);
+	int j = list->cnt - 1;
+	while (j > 0 && list->items[j - 1]->priority > object->priority) {
+		list->items[j] = list->items[j - 1];
+		j--;
+	}
+	list->items[j] = object;
+}
+
+// 'id' is the order of addition
+int drawnBefore(struct Object * a, struct Object * b) {
+	return a->priority < b->priority || (a->priority == b->priority && a->id < b->id);
+}
+
+// 'scene' merged with the overlay
+void mergeScene(struct ObjectList * out, int scene) {
+	struct ObjectList * a = &scene_objects[scene], * b = &overlay_objects;
+	int i = 0, j = 0;
+	out->cnt = 0;
+	while (i < a->cnt || j < b->cnt) {
+		if (j == b->cnt || (i < a->cnt && drawnBefore(a->items[i], b->items[j]))) listAppend(out, a->items[i++]);
+		else listAppend(out, b->items[j++]);
+	}
+}
+
+struct ObjectList * visibleObjects() {
+	if (draw_list_scene == current_scene && draw_list_version == objects_version) return &draw_list;
+	mergeScene(&draw_list, current_scene);
+	draw_list_scene = current_scene;
+	draw_list_version = objects_version;
+	return &draw_list;
+}
+
+// scene < 0 - object is shown in all scenes
+void addObject(struct Object * object, int scene) {
+	if (scene >= MAX_SCENES) {
+		fprintf(stderr, "addObject: scene %i >= MAX_SCENES\n", scene);
+		return;
+	}
+	invalidateTouchIndex();
+	object->scene = scene;
+	object->id = cnt_objects++;
+	listInsert(scene < 0 ? &overlay_objects : &scene_objects[scene], object);
+	objects_version++;
+	if (!object->dynamic) invalidateLayer(scene);
+}
+// OBJECT LISTS
+
+void addObjectToAll(struct Object * object) {
+	addObject(object, -1);
+}
+
+void drawRect(struct Rect * rect) {
+	if (rect->hide) return;
+	render->fillRect(rect->x1, rect->y1, rect->x2, rect->y2, rect->r, rect->g, rect->b, rect->a);
+}
+
+void drawBox(struct Box * box) {
+	if (box->hide) return;
+	render->strokeRect(box->x1, box->y1, box->x2, box->y2, box->w, box->r, box->g, box->b, box->a);
+}
+
+// Run of 'text' in the text cache, NULL if it has to be drawn directly
+struct TextRun * textRun(struct Text * text) {
+	if (text->dynamic || text->len == 0 || text->run == -2) return NULL;
+	if (text->run == -1) {
+		text->run = textCacheFind(text->font, text->font_size, text->s, text->len);
+		if (text->run < 0) {
+			text->run = -2;
+			return NULL;
+		}
+	}
+	return &text_runs[text->run];
+}
+
+void drawText(struct Text * text) {
+	if (text->hide) return;
+	int x = text->x + text->dx, y = text->y + text->dy;
+	struct TextRun * run = textRun(text);
+	if (run && run->handle >= 0) {
+		render->drawPrepared(run->handle, x, y, text->r, text->g, text->b, text->a);
+		text_cache_stats.drawn_cached++;
+		return;
+	}
+	text_cache_stats.drawn_direct++;
+	render->text(text->font, text->font_size, x, y, text->s, text->len, text->r, text->g, text->b, text->a);
+}
+
+/*
+Priority:
+1. Rectangles
+2. Boxes
+3. Texts
+*/
+void drawObject(struct Object * object) {
+	if (object->hide) return;
+	for (int i = 0; i < object->cnt_rects; i++) {
+		drawRect(&object->rects[i]);
+	}
+	for (int i = 0; i < object->cnt_boxes; i++) {
+		drawBox(&object->boxes[i]);
+	}
+	for (int i = 0; i < object->cnt_texts; i++) {
+		drawText(&object->texts[i]);
+	}
+}
+
+void warmObjectTexts(struct ObjectList * list) {
+	for (int i = 0; i < list->cnt; i++) {
+		struct Object * o = list->items[i];
+		for (int j = 0; j < o->cnt_texts; j++) textRun(&o->texts[j]);
+	}
+}
+
+void warmTextCache() {
+	for (int i = 0; i < MAX_SCENES; i++) warmObjectTexts(&scene_objects[i]);
+	warmObjectTexts(&overlay_objects);
+	textCachePrepare();
+}
+
+// DAMAGE
+// Only the parts of the screen covered by changed objects are redrawn and uploaded
+
+struct Bounds damage[MAX_DAMAGE];
+int cnt_damage = 0;
+
+int isEmpty(struct Bounds b) {
+	return b.x1 >= b.x2 || b.y1 >= b.y2;
+}
+
+int intersects(struct Bounds a, struct Bounds b) {
+	return a.x1 < b.x2 && b.x1 < a.x2 && a.y1 < b.y2 && b.y1 < a.y2;
+}
+
+struct Bounds unite(struct Bounds a, struct Bounds b) {
+	if (isEmpty(a)) return b;
+	if (isEmpty(b)) return a;
+	if (b.x1 < a.x1) a.x1 = b.x1;
+	if (b.y1 < a.y1) a.y1 = b.y1;
+	if (b.x2 > a.x2) a.x2 = b.x2;
+	if (b.y2 > a.y2) a.y2 = b.y2;
+	return a;
+}
+
+void addDamage(struct Bounds b) {
+	if (isEmpty(b)) return;
+	for (int i = 0; i < cnt_damage; i++) {
+		if (intersects(damage[i], b)) {
+			damage[i] = unite(damage[i], b);
+			return;
+		}
+	}
+	if (cnt_damage == MAX_DAMAGE) {
+		for (int i = 1; i < cnt_damage; i++) damage[0] = unite(damage[0], damage[i]);
+		damage[0] = unite(damage[0], b);
+		cnt_damage = 1;
+		return;
+	}
+	damage[cnt_damage++] = b;
+}
+
+void damageAll() {
+	struct Bounds b = {0, 0, width, height};
+	cnt_damage = 0;
+	addDamage(b);
+}
+
+struct Bounds rectBounds(int x1, int y1, int x2, int y2, int pad) {
+	struct Bounds b;
+	b.x1 = (x1 < x2 ? x1 : x2) - pad;
+	b.y1 = (y1 < y2 ? y1 : y2) - pad;
+	b.x2 = (x1 < x2 ? x2 : x1) + pad + 1;
+	b.y2 = (y1 < y2 ? y2 : y1) + pad + 1;
+	return b;
+}
+
+// Area that 'object' would cover if it was drawn now. Includes antialiasing.
+struct Bounds objectBounds(struct Object * object) {
+	struct Bounds b = {0, 0, 0, 0};
+	if (object->hide) return b;
+	for (int i = 0; i < object->cnt_rects; i++) {
+		struct Rect * r = &object->rects[i];
+		if (!r->hide) b = unite(b, rectBounds(r->x1, r->y1, r->x2, r->y2, 1));
+	}
+	for (int i = 0; i < object->cnt_boxes; i++) {
+		struct Box * r = &object->boxes[i];
+		if (!r->hide) b = unite(b, rectBounds(r->x1, r->y1, r->x2, r->y2, r->w / 2 + 1));
+	}
+	for (int i = 0; i < object->cnt_texts; i++) {
+		struct Text * t = &object->texts[i];
+		if (t->hide || t->len == 0) continue;
+		int x = t->x + t->dx, y = t->y + t->dy;
+		float tb[4];
+		struct TextRun * run = textRun(t);
+		if (run) {
+			tb[0] = run->bounds[0] + x;
+			tb[1] = run->bounds[1] + y;
+			tb[2] = run->bounds[2] + x;
+			tb[3] = run->bounds[3] + y;
+		} else {
+			render->textBounds(t->font, t->font_size, x, y, t->s, t->len, tb);
+		}
+		b = unite(b, rectBounds(tb[0], tb[1], tb[2], tb[3], 2));
+	}
+	return b;
+}
+
+// LAYERS
+// Static objects of every scene are drawn once into an offscreen layer of the backend and
+// redrawn only after one of them changes. A frame copies the damaged areas from the layer and
+// draws the dynamic objects over them, so static objects must not cover dynamic ones.
+
+struct LayerStats layer_stats;
+
+int scene_layer[MAX_SCENES];
+int layer_created[MAX_SCENES]; // 1 - created, -1 - the backend failed to create it
+int layer_valid[MAX_SCENES];
+struct ObjectList layer_list;
+long switch_start = 0;
+
+void invalidateLayer(int scene) {
+	if (scene >= 0) {
+		layer_valid[scene] = 0;
+		return;
+	}
+	for (int i = 0; i < MAX_SCENES; i++) layer_valid[i] = 0;
+}
+
+// Returns 0 if the backend has no layers
+int buildLayer(int scene) {
+	if (render->createLayer == NULL || layer_created[scene] < 0) return 0;
+	if (!layer_created[scene]) {
+		scene_layer[scene] = render->createLayer();
+		layer_created[scene] = scene_layer[scene] < 0 ? -1 : 1;
+		if (layer_created[scene] < 0) return 0;
+	}
+
+	long t = monotonicUs();
+	mergeScene(&layer_list, scene);
+	render->beginLayer(scene_layer[scene]);
+	for (int i = 0; i < layer_list.cnt; i++) {
+		if (!layer_list.items[i]->dynamic) drawObject(layer_list.items[i]);
+	}
+	render->endLayer();
+	layer_valid[scene] = 1;
+
+	t = monotonicUs() - t;
+	layer_stats.rebuilds++;
+	layer_stats.last_rebuild_us = t;
+	if (t > layer_stats.max_rebuild_us) layer_stats.max_rebuild_us = t;
+	return 1;
+}
+
+void prerenderScenes() {
+	// The first frame isn't a scene switch
+	switch_start = 0;
+	for (int i = 0; i < MAX_SCENES; i++) {
+		if (scene_objects[i].cnt && !buildLayer(i)) return;
+	}
+}
+
+void switchScene(int scene) {
+	current_scene = scene;
+	switch_start = monotonicUs();
+	damageAll();
+}
+
+void frameShown() {
+	if (switch_start == 0) return;
+	long t = monotonicUs() - switch_start;
+	switch_start = 0;
+	layer_stats.switches++;
+	layer_stats.last_switch_us = t;
+	layer_stats.total_switch_us += t;
+	if (t > layer_stats.max_switch_us) layer_stats.max_switch_us = t;
+}
+// LAYERS
+
+// Turns dirty objects of the current scene into damage. Returns the number of damaged areas.
+int updateDamage() {
+	// Called before render->beginFrame(): lay out the texts met in the last frame
+	textCachePrepare();
+	if (!layer_valid[current_scene]) buildLayer(current_scene);
+
+	struct ObjectList * list = visibleObjects();
+	for (int i = 0; i < list->cnt; i++) {
+		struct Object * o = list->items[i];
+		if (!o->dirty) continue;
+		if (o->drawn) addDamage(o->bounds);
+		o->bounds = objectBounds(o);
+		o->drawn = !isEmpty(o->bounds);
+		if (o->drawn) addDamage(o->bounds);
+		o->dirty = 0;
+	}
+	return cnt_damage;
+}
+
+void takeSnapshot(struct Snapshot * snap) {
+	struct ObjectList * list = visibleObjects();
+	snap->scene = current_scene;
+	snap->layer = layer_valid[current_scene] && layer_created[current_scene] == 1 ? scene_layer[current_scene] : -1;
+	snap->cnt_damage = cnt_damage;
+	memcpy(snap->damage, damage, sizeof(struct Bounds) * cnt_damage);
+	snap->cnt = 0;
+	for (int i = 0; i < list->cnt; i++) {
+		struct Object * o = list->items[i];
+		if (!o->drawn || (snap->layer >= 0 && !o->dynamic)) continue;
+		int hit = 0;
+		for (int d = 0; d < cnt_damage && !hit; d++) hit = intersects(o->bounds, damage[d]);
+		if (!hit) continue;
+
+		// Only the render thread owns this, so it isn't in ui_arena
+		if (snap->cnt == snap->cap) {
+			snap->cap = snap->cap ? snap->cap * 2 : 32;
+			snap->objects = (struct Object *) realloc(snap->objects, sizeof(struct Object) * snap->cap);
+		}
+		// The copies keep the text cache entries
+		for (int j = 0; j < o->cnt_texts; j++) textRun(&o->texts[j]);
+		snap->objects[snap->cnt++] = *o;
+	}
+	cnt_damage = 0;
+}
+
+void drawSnapshot(struct Snapshot * snap) {
+	for (int d = 0; d < snap->cnt_damage; d++) {
+		struct Bounds b = snap->damage[d];
+		render->clip(b.x1, b.y1, b.x2 - b.x1, b.y2 - b.y1);
+		if (snap->layer >= 0) render->drawLayer(snap->layer);
+		for (int i = 0; i < snap->cnt; i++) {
+			if (intersects(snap->objects[i].bounds, b)) drawObject(&snap->objects[i]);
+		}
+	}
+	render->resetClip();
+}
+
+void drawScene() {
+	static struct Snapshot snap;
+	takeSnapshot(&snap);
+	drawSnapshot(&snap);
+}
+// DAMAGE
+
+// TOUCH INDEX
+// Uniform grid over the screen, one per scene. Each cell lists the touchable objects whose
+// touch area overlaps it, highest priority first. Rebuilt lazily after objects are added
+// or their touch areas / visibility change.
+
+struct TouchGrid touch_grids[MAX_SCENES];
+int touch_index_version = 1;
+
+void invalidateTouchIndex() {
+	touch_index_version++;
+}
+
+int cellX(int x) {
+	int c = x * GRID_W / width;
+	return c < 0 ? 0 : (c >= GRID_W ? GRID_W - 1 : c);
+}
+
+int cellY(int y) {
+	int c = y * GRID_H / height;
+	return c < 0 ? 0 : (c >= GRID_H ? GRID_H - 1 : c);
+}
+
+// Built for the current scene
+void buildTouchGrid(struct TouchGrid * grid) {
+	struct ObjectList * list = visibleObjects();
+	int cnt[GRID_W * GRID_H];
+	memset(cnt, 0, sizeof(cnt));
+	for (int pass = 0; pass < 2; pass++) {
+		// Descending order, so the first match in a cell is the one registerTouch() used to find
+		for (int i = list->cnt - 1; i >= 0; i--) {
+			struct Object * o = list->items[i];
+			if (!o->can_touch) continue;
+			for (int cy = cellY(o->tarea.y1); cy <= cellY(o->tarea.y2); cy++) {
+				for (int cx = cellX(o->tarea.x1); cx <= cellX(o->tarea.x2); cx++) {
+					int c = cy * GRID_W + cx;
+					if (pass == 0) cnt[c]++;
+					else grid->items[grid->start[c] + cnt[c]++] = i;
+				}
+			}
+		}
+		if (pass == 0) {
+			grid->start[0] = 0;
+			for (int c = 0; c < GRID_W * GRID_H; c++) {
+				grid->start[c + 1] = grid->start[c] + cnt[c];
+				cnt[c] = 0;
+			}
+			if (grid->start[GRID_W * GRID_H] > grid->cap) {
+				grid->cap = grid->start[GRID_W * GRID_H];
+				grid->items = (int *) arenaAlloc(&ui_arena, sizeof(int) * grid->cap);
+			}
+		}
+	}
+	grid->version = touch_index_version;
+}
+
+// Index in visibleObjects() of the touched object, -1 if none
+int findTouched(int x, int y) {
+	struct ObjectList * list = visibleObjects();
+	struct TouchGrid * grid = &touch_grids[current_scene];
+	if (grid->version != touch_index_version) buildTouchGrid(grid);
+	int c = cellY(y) * GRID_W + cellX(x);
+	for (int k = grid->start[c]; k < grid->start[c + 1]; k++) {
+		if (isTouched(list->items[grid->items[k]], x, y)) return grid->items[k];
+	}
+	return -1;
+}
+// TOUCH INDEX
+
+void registerTouch(int x, int y) {
+	int i = findTouched(x, y);
+	traceEvent(TRACE_TOUCH, i);
+	if (i >= 0) {
+		touchEvent(visibleObjects()->items[i], x, y);
+	}
+}
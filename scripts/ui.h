@@ -0,0 +1,166 @@
+#ifndef UI_H
+#define UI_H
+
+#include "arena.h"
+
+#define MAX_CHILDREN 5
+#define MAX_SCENES 16
+#define MAX_TEXT_LEN 15
+#define MAX_DAMAGE 8
+#define GRID_W 16
+#define GRID_H 10
+
+struct Object;
+
+struct Text {
+	char s[MAX_TEXT_LEN + 1];
+	int len, max_len;
+
+	int font, font_size;
+	int x, y, dx, dy;
+	int r, g, b, a;
+	int hide;
+	int pswd;
+	// Changes all the time (clock, PIN): drawn without the text cache
+	int dynamic;
+	int run; // entry in text_runs, -1 if not looked up yet, -2 if the cache is full
+
+	struct Object * owner;
+};
+
+struct Box {
+	int x1, y1, x2, y2;
+	int r, g, b, a, w;
+	int hide;
+};
+
+struct Rect {
+	int x1, y1, x2, y2;
+	int r, g, b, a;
+	int hide;
+};
+
+struct TouchArea {
+	int x1, y1, x2, y2;
+};
+
+// Screen area, x2 and y2 are exclusive
+struct Bounds {
+	int x1, y1, x2, y2;
+};
+
+struct Object {
+	int scene, id, priority;
+	int hide;
+	// Changes often: drawn over the layer of the scene instead of into it
+	int dynamic;
+
+	// 'dirty' is set whenever something visible changes,
+	// 'bounds' is the area the object covered when it was drawn the last time
+	int dirty, drawn;
+	struct Bounds bounds;
+
+	int cnt_rects, cnt_boxes, cnt_texts;
+	struct Rect rects[MAX_CHILDREN];
+	struct Box boxes[MAX_CHILDREN];
+	struct Text texts[MAX_CHILDREN];
+
+	int can_touch, has_focus;
+	struct TouchArea tarea;
+	int touch_event, data;
+};
+
+struct ObjectList {
+	struct Object ** items;
+	int cnt, cap;
+};
+
+struct LayerStats {
+	long rebuilds, last_rebuild_us, max_rebuild_us;
+	// From switchScene() to the end of the frame that shows the new scene
+	long switches, last_switch_us, max_switch_us, total_switch_us;
+};
+
+// What a frame needs, copied so the UI can change while it is drawn (see scheduler.c)
+struct Snapshot {
+	int scene;
+	int layer;	// layer of the scene, -1 if everything is drawn from 'objects'
+	struct Bounds damage[MAX_DAMAGE];
+	int cnt_damage;
+	struct Object * objects;	// copies of the objects in the damaged areas, in drawing order
+	int cnt, cap;
+};
+
+// Uniform grid over the screen, one per scene. Each cell lists the touchable objects whose
+// touch area overlaps it, highest priority first.
+struct TouchGrid {
+	int version;
+	int start[GRID_W * GRID_H + 1]; // cell c lists items[start[c]] .. items[start[c + 1] - 1]
+	int * items; // indices in the scene's draw list
+	int cap;
+};
+
+extern int width, height;
+extern int current_scene;
+
+// All memory of the UI (object lists, touch grids) comes from this arena.
+// Its counters must not move once the scenes are built.
+extern struct Arena ui_arena;
+// Allocations between the last two frames
+extern long last_frame_allocs;
+extern struct LayerStats layer_stats;
+
+void addString(struct Text * text, char * s);
+void addChar(struct Text * text, char c);
+void clearText(struct Text * text);
+void removeText(struct Text * text, int n);
+void removeChar(struct Text * text);
+
+int isTouched(struct Object * object, int x, int y);
+void setTouchArea(struct Object * object, int x1, int y1, int x2, int y2);
+void defaultObject(struct Object * object);
+void markDirty(struct Object * object);
+void setHidden(struct Object * object, int hide);
+
+void addColorRect(struct Object * object, int x1, int y1, int x2, int y2, int r, int g, int b, int a);
+void addRect(struct Object * object, int x1, int y1, int x2, int y2);
+void addColorBox(struct Object * object, int x1, int y1, int x2, int y2, int r, int g, int b, int a, int w);
+void addBox(struct Object * object, int x1, int y1, int x2, int y2, int w);
+struct Text* addColorText(struct Object * object, int x, int dx, int y, int dy, int font, int font_size, int r, int g, int b, int a, int max_len);
+struct Text* addText(struct Object * object, int x, int dx, int y, int dy, int font, int font_size, int max_len);
+
+// scene < 0 - object is shown in all scenes
+void addObject(struct Object * object, int scene);
+void addObjectToAll(struct Object * object);
+// Current scene merged with the overlay: what is drawn and touched
+struct ObjectList * visibleObjects();
+
+void drawObject(struct Object * object);
+// Puts the texts of all scenes into the text cache (textcache.h)
+void warmTextCache();
+
+// The whole screen has to be redrawn
+void damageAll();
+void switchScene(int scene);
+// Draws the static objects of all scenes into their layers, if the backend has them
+void prerenderScenes();
+// Turns dirty objects of the current scene into damage. Returns the number of damaged areas.
+int updateDamage();
+// Copies the damage and the objects in it and clears the damage. Call after updateDamage().
+void takeSnapshot(struct Snapshot * snap);
+// Must be called between render->beginFrame() and render->endFrame()
+void drawSnapshot(struct Snapshot * snap);
+// Redraws the damaged areas, takeSnapshot() and drawSnapshot() in one go
+void drawScene();
+// Call after render->endFrame()
+void frameShown();
+
+void invalidateTouchIndex();
+// Index in visibleObjects() of the touched object, -1 if none
+int findTouched(int x, int y);
+void registerTouch(int x, int y);
+
+// Implemented by the scenes (scenes.c)
+void touchEvent(struct Object * object, int x, int y);
+
+#endif
@@ -0,0 +1,224 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "accesslog.h"
+#include "ui.h"
+#include "scenes.h"
+#include "status.h"
+#include "computers.h"
+#include "render_raster.h"
+#include "textcache.h"
+
+/*
+	Replays a scripted session on the software rasterizer and reports, per frame, the
+	render time, the pixels written and the arena allocations.
+	Options: 'nocache' draws texts without the text cache, 'nolayers' without the scene layers.
+	Every frame is drawn twice: with damage tracking as the program does it and as a full
+	redraw of the scene, to see what the damage rects save.
+
+	Usage: ./uibench [rounds] [nocache] [nolayers]
+	Fails if a frame after the first one allocates from the arena.
+*/
+
+int cnt_attempts = 0;
+
+// The scripted PIN is accepted every other time
+int logAttempt(int id, char * pswd, int reserved) {
+	cnt_attempts++;
+	if (cnt_attempts % 2 == 0) return ACCESS_DENIED;
+	return reserved ? ACCESS_RESERVED : ACCESS_GRANTED;
+}
+
+void finishAttempt(int outcome) {}
+
+void openLock(int comp) {}
+void closeLock(int comp) {}
+
+FILE * out;
+
+struct Step {
+	const char * name;
+	long us, pixels, allocs;
+	long full_us, full_pixels;
+	int frames;
+};
+
+#define MAX_STEPS 64
+
+struct Step steps[MAX_STEPS];
+int cnt_steps = 0;
+
+// Draws one frame the way main.c does and accounts it to the step 'name'
+void frame(const char * name) {
+	struct Step * step = NULL;
+	for (int i = 0; i < cnt_steps; i++) {
+		if (strcmp(steps[i].name, name) == 0) step = &steps[i];
+	}
+	if (!step && cnt_steps < MAX_STEPS) {
+		step = &steps[cnt_steps++];
+		step->name = name;
+	}
+
+	long allocs = ui_arena.cnt_allocs;
+	long pixels = raster_stats.pixels;
+	long t = monotonicUs();
+	if (updateDamage()) {
+		render->beginFrame();
+		drawScene();
+		render->endFrame();
+		frameShown();
+	}
+	t = monotonicUs() - t;
+
+	step->us += t;
+	step->pixels += raster_stats.pixels - pixels;
+	step->allocs += ui_arena.cnt_allocs - allocs;
+	step->frames++;
+
+	// Same frame without damage tracking
+	pixels = raster_stats.pixels;
+	t = monotonicUs();
+	damageAll();
+	updateDamage();
+	render->beginFrame();
+	drawScene();
+	render->endFrame();
+	step->full_us += monotonicUs() - t;
+	step->full_pixels += raster_stats.pixels - pixels;
+}
+
+void tap(struct Object * object) {
+	int x = (object->tarea.x1 + object->tarea.x2) / 2;
+	int y = (object->tarea.y1 + object->tarea.y2) / 2;
+	showTouch(x, y);
+	registerTouch(x, y);
+}
+
+struct Object * keypad(int ev, int data) {
+	for (int i = 0; i < MAX_BUTTONS; i++) {
+		if (buttons[i].touch_event == ev && (ev != 2 || buttons[i].data == data)) return &buttons[i];
+	}
+	return NULL;
+}
+
+void session(int round) {
+	for (int i = 0; i < 10; i++) frame("idle");
+
+	setTime(round / 60 % 24, round % 60);
+	frame("clock");
+
+	for (int i = 0; i < 3; i++) {
+		tap(&buttonR);
+		frame("page right");
+	}
+	for (int i = 0; i < 3; i++) {
+		tap(&buttonL);
+		frame("page left");
+	}
+
+	tap(&computerIcon[round % 12]);
+	frame("select computer");
+
+	const char * pin = "1234567";
+	for (int i = 0; pin[i]; i++) {
+		struct Object * key = keypad(2, pin[i]);
+		if (key) tap(key);
+		frame("type digit");
+	}
+	struct Object * key = keypad(3, 0);
+	if (key) tap(key);
+	frame("erase");
+
+	for (int i = 0; i < 5; i++) frame("idle");
+
+	key = keypad(4, 0);
+	if (key) tap(key);
+	frame("submit");
+
+	if (current_scene == RETURN_SCENE) {
+		tap(&returnLater);
+		frame("return time");
+		tap(&returnOk);
+		frame("confirm");
+	}
+
+	tap(&backButton[current_scene]);
+	frame("back");
+	if (current_scene != 0) {
+		tap(&backButton[current_scene]);
+		frame("back");
+	}
+}
+
+int main(int argc, char * argv[]) {
+	int rounds = 20;
+	if (argc > 1) rounds = atoi(argv[1]);
+
+	// The UI logs to stdout, keep it out of the report
+	out = fdopen(dup(1), "w");
+	freopen("/dev/null", "w", stdout);
+
+	if (statusInit(COMPUTERS_FILE) != 0) {
+		for (int i = 0; i < MAX_COMP; i++) c_status[i] = 1;
+	}
+	for (int i = 0; i < 12; i++) c_status[i] = 1;
+
+	render = renderRasterInit(800, 480);
+	width = render->width;
+	height = render->height;
+	for (int i = 2; i < argc; i++) {
+		if (strcmp(argv[i], "nocache") == 0) render->prepareText = NULL;
+		if (strcmp(argv[i], "nolayers") == 0) render->createLayer = NULL;
+	}
+	buildScenes(render->createFont("sans", "CourierNewBd.ttf"));
+	warmTextCache();
+	prerenderScenes();
+
+	long t = monotonicUs();
+	frame("first frame");
+	for (int r = 0; r < rounds; r++) session(r);
+	t = monotonicUs() - t;
+
+	fprintf(out, "%d rounds, %ld frames in %.1f ms\n\n", rounds, raster_stats.frames, t / 1000.0);
+	fprintf(out, "%-16s %7s %10s %12s %8s %12s %12s\n", "step", "frames", "us/frame", "pixels/frame",
+		"allocs", "full us", "full pixels");
+
+	long us = 0, full_us = 0, pixels = 0, full_pixels = 0, allocs = 0, frames = 0;
+	int allocating = 0;
+	for (int i = 0; i < cnt_steps; i++) {
+		struct Step * s = &steps[i];
+		if (s->allocs != 0 && strcmp(s->name, "first frame") != 0) allocating++;
+		fprintf(out, "%-16s %7d %10.1f %12ld %8ld %12.1f %12ld\n", s->name, s->frames,
+			(double) s->us / s->frames, s->pixels / s->frames, s->allocs,
+			(double) s->full_us / s->frames, s->full_pixels / s->frames);
+		us += s->us;
+		full_us += s->full_us;
+		pixels += s->pixels;
+		full_pixels += s->full_pixels;
+		allocs += s->allocs;
+		frames += s->frames;
+	}
+	fprintf(out, "\ntotal: %.1f us/frame, %ld pixels/frame, %ld allocs\n",
+		(double) us / frames, pixels / frames, allocs);
+	fprintf(out, "full redraw: %.1f us/frame, %ld pixels/frame\n",
+		(double) full_us / frames, full_pixels / frames);
+
+	fprintf(out, "text cache: %ld lookups, %ld hits, %ld runs prepared, %ld didn't fit, %ld not cached\n",
+		text_cache_stats.lookups, text_cache_stats.hits, text_cache_stats.prepared, text_cache_stats.failed,
+		text_cache_stats.full);
+	fprintf(out, "scene switches: %ld, %.1f us average, %ld us max; %ld layer redraws, %ld us max\n",
+		layer_stats.switches, layer_stats.switches ? (double) layer_stats.total_switch_us / layer_stats.switches : 0.0,
+		layer_stats.max_switch_us, layer_stats.rebuilds, layer_stats.max_rebuild_us);
+	fprintf(out, "texts drawn: %ld from the atlas, %ld directly\n", text_cache_stats.drawn_cached,
+		text_cache_stats.drawn_direct);
+
+	renderRasterClose();
+	statusClose();
+	if (allocating) {
+		fprintf(out, "FAILED: %i steps allocate after the first frame\n", allocating);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,513 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "status.h"
+#include "uplink.h"
+
+// Without an ack for this long the connection is considered dead
+#define ACK_TIMEOUT_MS 30000
+#define IO_TIMEOUT_MS 5000
+
+struct UplinkStats uplink_stats;
+
+static char host[128], port[16];
+static uint32_t kiosk = 0;
+static char dir[256];
+static volatile int running = 0;
+static pthread_t thread;
+
+// Entries put since the last seal
+static pthread_mutex_t put_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned char * cur = NULL;
+static int cur_len = 0, cur_cap = 0;
+static long cur_since = 0;
+
+// Sealed and not acked, oldest first. Only the sender thread touches these.
+static uint64_t pending[UPLINK_MAX_BACKLOG];
+static int pend_head = 0, pend_cnt = 0;
+static uint64_t next_seq = 1, acked = 0;
+
+// Until the server's first ack says where its sequence numbers are, batches are sealed
+// without one (u<n>.batch) and numbered after that ack, oldest first
+static int numbered = 0;
+static uint64_t unnumbered[UPLINK_MAX_BACKLOG];
+static int unnum_head = 0, unnum_cnt = 0;
+static uint64_t next_local = 1;
+static long sent_at[UPLINK_WINDOW];
+
+void uplinkPut(int type, const void * data, int len) {
+	if (!running) return;
+	pthread_mutex_lock(&put_lock);
+	if (cur_len + len + 5 > cur_cap) {
+		int cap = cur_cap ? cur_cap : 4096;
+		while (cur_len + len + 5 > cap) cap *= 2;
+		// A batch that grows this much means the sender is stuck, it's sealed on its next turn
+		if (cap > 4 * UPLINK_BATCH_MAX) {
+			uplink_stats.dropped++;
+			pthread_mutex_unlock(&put_lock);
+			return;
+		}
+		cur = (unsigned char *) realloc(cur, cap);
+		cur_cap = cap;
+	}
+	if (cur_len == 0) cur_since = monotonicUs();
+	uint32_t l = len;
+	cur[cur_len] = type;
+	memcpy(cur + cur_len + 1, &l, 4);
+	memcpy(cur + cur_len + 5, data, len);
+	cur_len += len + 5;
+	pthread_mutex_unlock(&put_lock);
+}
+
+// OUTBOX
+
+static void batchPath(uint64_t seq, char * path, int len) {
+	snprintf(path, len, "%s/%020llu.batch", dir, (unsigned long long) seq);
+}
+
+static void unnumberedPath(uint64_t n, char * path, int len) {
+	snprintf(path, len, "%s/u%020llu.batch", dir, (unsigned long long) n);
+}
+
+// So that a rename in it survives a power cut
+static void syncDir() {
+	int fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0) return;
+	fsync(fd);
+	close(fd);
+}
+
+// Through a synced temporary file, the file is there completely or not at all
+static int writeFile(const char * path, const void * buf, size_t len) {
+	char tmp[310];
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	int ok = fd >= 0 && write(fd, buf, len) == (ssize_t) len && fdatasync(fd) == 0;
+	if (fd >= 0) close(fd);
+	if (ok && rename(tmp, path) == 0) {
+		syncDir();
+		return 0;
+	}
+	perror(tmp);
+	unlink(tmp);
+	return -1;
+}
+
+// Written before the batches up to it are deleted: a lost cursor would number new batches
+// like ones the server already has
+static void saveAcked() {
+	char path[300], s[32];
+	snprintf(path, sizeof(path), "%s/acked", dir);
+	int len = snprintf(s, sizeof(s), "%llu\n", (unsigned long long) acked);
+	writeFile(path, s, len);
+}
+
+static void updateBacklog() {
+	uplink_stats.backlog = pend_cnt + unnum_cnt;
+}
+
+static void popPending() {
+	char path[300];
+	batchPath(pending[pend_head], path, sizeof(path));
+	unlink(path);
+	pend_head = (pend_head + 1) % UPLINK_MAX_BACKLOG;
+	pend_cnt--;
+	updateBacklog();
+}
+
+static void pushPending(uint64_t seq) {
+	if (pend_cnt == UPLINK_MAX_BACKLOG) {
+		popPending();
+		uplink_stats.dropped++;
+	}
+	pending[(pend_head + pend_cnt) % UPLINK_MAX_BACKLOG] = seq;
+	pend_cnt++;
+	updateBacklog();
+}
+
+static void popUnnumbered() {
+	char path[300];
+	unnumberedPath(unnumbered[unnum_head], path, sizeof(path));
+	unlink(path);
+	unnum_head = (unnum_head + 1) % UPLINK_MAX_BACKLOG;
+	unnum_cnt--;
+	updateBacklog();
+}
+
+static void pushUnnumbered(uint64_t n) {
+	if (unnum_cnt == UPLINK_MAX_BACKLOG) {
+		popUnnumbered();
+		uplink_stats.dropped++;
+	}
+	unnumbered[(unnum_head + unnum_cnt) % UPLINK_MAX_BACKLOG] = n;
+	unnum_cnt++;
+	updateBacklog();
+}
+
+static int sealDue() {
+	pthread_mutex_lock(&put_lock);
+	int due = cur_len > 0 && (cur_len >= UPLINK_BATCH_MAX || monotonicUs() - cur_since >= UPLINK_SEAL_MS * 1000L);
+	pthread_mutex_unlock(&put_lock);
+	return due;
+}
+
+// Compresses what was put into the next batch file
+static void seal() {
+	pthread_mutex_lock(&put_lock);
+	unsigned char * raw = cur;
+	int raw_len = cur_len;
+	cur = NULL;
+	cur_len = cur_cap = 0;
+	pthread_mutex_unlock(&put_lock);
+	if (raw_len == 0) {
+		free(raw);
+		return;
+	}
+
+	uLongf len = compressBound(raw_len);
+	unsigned char * buf = (unsigned char *) malloc(sizeof(struct UplinkFrame) + len);
+	if (compress2(buf + sizeof(struct UplinkFrame), &len, raw, raw_len, Z_BEST_SPEED) != Z_OK) {
+		fprintf(stderr, "uplink: compress failed, %i bytes lost\n", raw_len);
+		free(raw);
+		free(buf);
+		return;
+	}
+	struct UplinkFrame h;
+	h.magic = UPLINK_MAGIC;
+	h.len = len;
+	h.raw_len = raw_len;
+	h.crc = crc32(0, buf + sizeof(h), len);
+	h.seq = numbered ? next_seq : 0;
+	memcpy(buf, &h, sizeof(h));
+
+	char path[300];
+	if (numbered) batchPath(h.seq, path, sizeof(path));
+	else unnumberedPath(next_local, path, sizeof(path));
+	if (writeFile(path, buf, sizeof(h) + len) == 0) {
+		if (numbered) pushPending(next_seq++);
+		else pushUnnumbered(next_local++);
+		uplink_stats.sealed++;
+		uplink_stats.raw_bytes += raw_len;
+	}
+	free(raw);
+	free(buf);
+}
+
+// After the first ack of the server: the batches sealed before get the next sequence numbers
+static void numberBatches() {
+	while (unnum_cnt > 0) {
+		char path[300];
+		unnumberedPath(unnumbered[unnum_head], path, sizeof(path));
+		FILE * f = fopen(path, "rb");
+		unsigned char * buf = NULL;
+		long len = 0;
+		if (f) {
+			fseek(f, 0, SEEK_END);
+			len = ftell(f);
+			fseek(f, 0, SEEK_SET);
+			buf = (unsigned char *) malloc(len > 0 ? len : 1);
+			if (len < (long) sizeof(struct UplinkFrame) || fread(buf, len, 1, f) != 1) len = 0;
+			fclose(f);
+		}
+		if (len > 0) {
+			struct UplinkFrame h;
+			memcpy(&h, buf, sizeof(h));
+			h.seq = next_seq;
+			memcpy(buf, &h, sizeof(h));
+			batchPath(h.seq, path, sizeof(path));
+			if (writeFile(path, buf, len) != 0) {
+				// Tried again after the next ack
+				free(buf);
+				return;
+			}
+			pushPending(next_seq++);
+		}
+		free(buf);
+		popUnnumbered();
+	}
+	numbered = 1;
+}
+
+static int cmpSeq(const void * a, const void * b) {
+	uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+	return x < y ? -1 : x > y;
+}
+
+// Picks up the batches of the last run
+static void loadOutbox() {
+	char path[300];
+	snprintf(path, sizeof(path), "%s/acked", dir);
+	FILE * f = fopen(path, "r");
+	if (f) {
+		unsigned long long a;
+		if (fscanf(f, "%llu", &a) == 1) acked = a;
+		fclose(f);
+	}
+	next_seq = acked + 1;
+
+	DIR * d = opendir(dir);
+	if (d == NULL) return;
+	struct dirent * e;
+	int cnt = 0;
+	while ((e = readdir(d)) != NULL) {
+		unsigned long long seq;
+		char tail[16];
+		if (sscanf(e->d_name, "u%llu.%15s", &seq, tail) == 2 && strcmp(tail, "batch") == 0) {
+			if (unnum_cnt < UPLINK_MAX_BACKLOG) unnumbered[unnum_cnt++] = seq;
+			if (seq >= next_local) next_local = seq + 1;
+			continue;
+		}
+		if (sscanf(e->d_name, "%llu.%15s", &seq, tail) != 2 || strcmp(tail, "batch") != 0) continue;
+		if (seq <= acked) {
+			batchPath(seq, path, sizeof(path));
+			unlink(path);
+			continue;
+		}
+		if (cnt < UPLINK_MAX_BACKLOG) pending[cnt++] = seq;
+		if (seq >= next_seq) next_seq = seq + 1;
+	}
+	closedir(d);
+	qsort(pending, cnt, sizeof(uint64_t), cmpSeq);
+	qsort(unnumbered, unnum_cnt, sizeof(uint64_t), cmpSeq);
+	pend_head = 0;
+	pend_cnt = cnt;
+	unnum_head = 0;
+	updateBacklog();
+	uplink_stats.last_acked = acked;
+}
+// OUTBOX
+
+// SENDER
+
+static int waitFd(int fd, int events, int ms) {
+	struct pollfd p = { fd, events, 0 };
+	return poll(&p, 1, ms) > 0 && (p.revents & events);
+}
+
+static int writeFull(int fd, const void * buf, size_t len) {
+	const char * p = (const char *) buf;
+	while (len > 0) {
+		if (!waitFd(fd, POLLOUT, IO_TIMEOUT_MS)) return -1;
+		ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return -1;
+		p += n;
+		len -= n;
+	}
+	return 0;
+}
+
+static int readFull(int fd, void * buf, size_t len) {
+	char * p = (char *) buf;
+	while (len > 0) {
+		if (!waitFd(fd, POLLIN, IO_TIMEOUT_MS)) return -1;
+		ssize_t n = recv(fd, p, len, 0);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return -1;
+		p += n;
+		len -= n;
+	}
+	return 0;
+}
+
+static int connectServer() {
+	struct addrinfo hints, * res;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host, port, &hints, &res) != 0) return -1;
+
+	int fd = socket(res->ai_family, res->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, res->ai_protocol);
+	if (fd >= 0 && connect(fd, res->ai_addr, res->ai_addrlen) != 0) {
+		int err = 0;
+		socklen_t l = sizeof(err);
+		if (errno != EINPROGRESS || !waitFd(fd, POLLOUT, IO_TIMEOUT_MS)
+			|| getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &l) != 0 || err != 0) {
+			close(fd);
+			fd = -1;
+		}
+	}
+	freeaddrinfo(res);
+	if (fd >= 0) {
+		int one = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	}
+	return fd;
+}
+
+// A batch that is gone or can't be read is lost: an empty one goes out under its number
+// instead, so the server sees no gap and the batches after it aren't held up
+static int sendLost(int fd, uint64_t seq) {
+	static const unsigned char none = 0;
+	unsigned char buf[sizeof(struct UplinkFrame) + 16];
+	uLongf len = sizeof(buf) - sizeof(struct UplinkFrame);
+	if (compress2(buf + sizeof(struct UplinkFrame), &len, &none, 0, Z_BEST_SPEED) != Z_OK) return -1;
+	struct UplinkFrame h = { UPLINK_MAGIC, len, 0, crc32(0, buf + sizeof(struct UplinkFrame), len), seq };
+	memcpy(buf, &h, sizeof(h));
+	fprintf(stderr, "uplink: batch %llu can't be read, sent empty\n", (unsigned long long) seq);
+	uplink_stats.dropped++;
+	return writeFull(fd, buf, sizeof(h) + len);
+}
+
+// Returns -1 only when the connection failed
+static int sendBatch(int fd, uint64_t seq) {
+	char path[300];
+	batchPath(seq, path, sizeof(path));
+	FILE * f = fopen(path, "rb");
+	if (f == NULL) return sendLost(fd, seq);
+	fseek(f, 0, SEEK_END);
+	long len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	unsigned char * buf = (unsigned char *) malloc(len > 0 ? len : 1);
+	int ok = len >= (long) sizeof(struct UplinkFrame) && fread(buf, len, 1, f) == 1;
+	fclose(f);
+	int res = ok ? writeFull(fd, buf, len) : sendLost(fd, seq);
+	free(buf);
+	if (res == 0) {
+		sent_at[seq % UPLINK_WINDOW] = monotonicUs();
+		uplink_stats.sent++;
+		if (ok) uplink_stats.sent_bytes += len;
+	}
+	return res;
+}
+
+// Deletes the batches up to 'seq', returns how many there were
+static int ackUpTo(uint64_t seq) {
+	if (seq > acked) {
+		acked = seq;
+		saveAcked();
+	}
+	int n = 0;
+	while (pend_cnt > 0 && pending[pend_head] <= seq) {
+		popPending();
+		n++;
+	}
+	if (seq >= next_seq) next_seq = seq + 1;
+	uplink_stats.acked += n;
+	uplink_stats.last_acked = acked;
+	return n;
+}
+
+// Returns when the connection fails or the uplink is closed
+static void session(int fd) {
+	struct UplinkHello hello = { UPLINK_MAGIC, UPLINK_VERSION, kiosk, 0 };
+	struct UplinkAck ack;
+	if (writeFull(fd, &hello, sizeof(hello)) != 0 || readFull(fd, &ack, sizeof(ack)) != 0 || ack.magic != UPLINK_MAGIC) {
+		return;
+	}
+	// The server has everything up to ack.seq, the rest is sent again
+	ackUpTo(ack.seq);
+	numberBatches();
+
+	int inflight = 0;
+	long last_progress = monotonicUs();
+	while (running) {
+		if (sealDue()) seal();
+		while (inflight < UPLINK_WINDOW && inflight < pend_cnt) {
+			if (sendBatch(fd, pending[(pend_head + inflight) % UPLINK_MAX_BACKLOG]) != 0) return;
+			inflight++;
+		}
+		if (inflight == 0) last_progress = monotonicUs();
+
+		if (waitFd(fd, POLLIN, 200)) {
+			if (readFull(fd, &ack, sizeof(ack)) != 0 || ack.magic != UPLINK_MAGIC) return;
+			long t = monotonicUs() - sent_at[ack.seq % UPLINK_WINDOW];
+			int n = ackUpTo(ack.seq);
+			inflight = n > inflight ? 0 : inflight - n;
+			if (n > 0) {
+				uplink_stats.last_ack_us = t;
+				if (t > uplink_stats.max_ack_us) uplink_stats.max_ack_us = t;
+				last_progress = monotonicUs();
+			}
+		} else if (monotonicUs() - last_progress > ACK_TIMEOUT_MS * 1000L) {
+			return;
+		}
+	}
+}
+
+static void * sender(void * arg) {
+	int backoff = 1, first = 1;
+	while (running) {
+		int fd = connectServer();
+		if (fd >= 0) {
+			if (!first) uplink_stats.reconnects++;
+			first = 0;
+			backoff = 1;
+			long acked_before = uplink_stats.acked;
+			session(fd);
+			close(fd);
+			// It was working, try again right away
+			if (uplink_stats.acked > acked_before) continue;
+		}
+
+		// Batches are still sealed while the server is away
+		for (long end = monotonicUs() + backoff * 1000000L; running && monotonicUs() < end; ) {
+			if (sealDue()) seal();
+			usleep(200000);
+		}
+		backoff = backoff * 2 > UPLINK_RETRY_MAX_S ? UPLINK_RETRY_MAX_S : backoff * 2;
+	}
+	return NULL;
+}
+// SENDER
+
+int uplinkInit(const char * config, const char * outbox) {
+	FILE * f = fopen(config, "r");
+	if (f == NULL) {
+		fprintf(stderr, "No %s, logs stay on the Pi\n", config);
+		return -1;
+	}
+	char line[256];
+	int ok = 0;
+	while (fgets(line, sizeof(line), f)) {
+		if (line[0] == '#') continue;
+		unsigned int k = 0;
+		if (sscanf(line, "%127s %15s %u", host, port, &k) >= 2) {
+			kiosk = k;
+			ok = 1;
+			break;
+		}
+	}
+	fclose(f);
+	if (!ok) return -1;
+
+	snprintf(dir, sizeof(dir), "%s", outbox);
+	mkdir(dir, 0755);
+	loadOutbox();
+
+	running = 1;
+	if (pthread_create(&thread, NULL, sender, NULL) != 0) {
+		perror("pthread_create");
+		running = 0;
+		return -1;
+	}
+	return 0;
+}
+
+void uplinkPrintStats(FILE * f) {
+	struct UplinkStats * s = &uplink_stats;
+	fprintf(f, "uplink: %ld batches sealed, %ld sent, %ld acked (up to %llu), %ld waiting, %ld dropped, %ld reconnects\n",
+		s->sealed, s->sent, s->acked, (unsigned long long) s->last_acked, s->backlog, s->dropped, s->reconnects);
+	fprintf(f, "uplink: %ld bytes put, %ld bytes sent, ack after %ld us (max %ld us)\n",
+		s->raw_bytes, s->sent_bytes, s->last_ack_us, s->max_ack_us);
+}
+
+void uplinkClose() {
+	if (!running) return;
+	running = 0;
+	pthread_join(thread, NULL);
+	seal();
+}
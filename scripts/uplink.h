@@ -0,0 +1,78 @@
+#ifndef UPLINK_H
+#define UPLINK_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define UPLINK_FILE "uplink.txt"
+#define UPLINK_DIR "../logs/outbox"
+// A batch is sealed this often or when it is this big
+#define UPLINK_SEAL_MS 5000
+#define UPLINK_BATCH_MAX 65536
+// Batches sent before the first of them has to be acked
+#define UPLINK_WINDOW 8
+// Sealed batches kept while the server can't be reached, the oldest are dropped after that
+#define UPLINK_MAX_BACKLOG 20000
+#define UPLINK_RETRY_MAX_S 60
+
+#define UPLINK_MAGIC 0x50554c43 // "CLUP"
+#define UPLINK_VERSION 1
+
+// Entries of a batch: "<u8 type> <u32 length> <data>"
+#define UPLINK_ACCESS 1		// struct AccessRecord[] (accesslog.h)
+#define UPLINK_OCCUPANCY 2	// records of the occupancy ring (snapshot.h)
+
+/*
+	Store and forward: entries are collected in memory, sealed into a batch with the next
+	sequence number, compressed (zlib) and written to UPLINK_DIR/<seq>.batch before they are
+	sent. A sender thread keeps up to UPLINK_WINDOW batches in flight over one TCP connection.
+	The server acks a sequence number once everything up to it is stored, the files up to it
+	are deleted then. After a reconnect the server says what it has, so sending resumes there.
+	Batches sealed before the first ack of a run wait as u<n>.batch and get their sequence
+	numbers from it, a stale local cursor can't reuse numbers the server already has.
+	A batch file that is gone or can't be read is sent empty under its number and counted as
+	dropped, the server would wait for it otherwise.
+
+	Protocol, little endian:
+	client: UplinkHello, then UplinkFrame + payload per batch
+	server: UplinkAck with the last stored seq, after the hello and whenever it stored more
+*/
+struct UplinkHello {
+	uint32_t magic, version, kiosk, reserved;
+};
+
+struct UplinkFrame {
+	uint32_t magic;
+	uint32_t len;		// of the compressed payload
+	uint32_t raw_len;	// before compression
+	uint32_t crc;		// crc32() of the compressed payload
+	uint64_t seq;
+};
+
+struct UplinkAck {
+	uint32_t magic, reserved;
+	uint64_t seq;
+};
+
+struct UplinkStats {
+	long sealed, sent, acked, dropped, reconnects;
+	long raw_bytes, sent_bytes;
+	long backlog;		// sealed batches that aren't acked yet
+	long last_ack_us, max_ack_us;	// from sending a batch to its ack
+	uint64_t last_acked;
+};
+
+extern struct UplinkStats uplink_stats;
+
+/*
+	uplink.txt: "<host> <port> [<kiosk id>]", the uplink is off without it.
+	Batches left from the last run are sent first.
+*/
+int uplinkInit(const char * config, const char * dir);
+// Thread-safe, never touches the disk or the network
+void uplinkPut(int type, const void * data, int len);
+void uplinkPrintStats(FILE * f);
+// Seals what was put, the outbox is sent on the next start
+void uplinkClose();
+
+#endif
@@ -0,0 +1,140 @@
+/*
+	Runs uplink.c against uplinkd.c on this machine. The first half of the entries is put
+	while the server is down, so they pile up in the outbox, then the server is started.
+	At the end the log the server stored is checked: every entry once and in order.
+
+	./uplinkbench [entries] [drop every]
+*/
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "status.h"
+#include "uplink.h"
+
+#define PORT "7071"
+#define CONFIG "/tmp/uplinkbench.txt"
+#define OUTBOX "/tmp/uplinkbench-outbox"
+#define SERVER_DIR "/tmp/uplinkbench-server"
+#define KIOSK 7
+
+// Looks like an access record: a counter and some slowly changing fields
+struct Entry {
+	int64_t t_us;
+	uint32_t n;
+	int32_t gui_id, comp, outcome, photo;
+	uint32_t check;
+};
+
+long max_backlog = 0;
+
+void putEntries(long from, long to) {
+	struct Entry e;
+	memset(&e, 0, sizeof(e));
+	for (long i = from; i < to; i++) {
+		e.t_us = 1700000000000000L + i * 1000;
+		e.n = i;
+		e.gui_id = i % 37;
+		e.comp = i % 12;
+		e.outcome = i % 5 == 0;
+		e.photo = i;
+		uplinkPut(UPLINK_ACCESS, &e, sizeof(e));
+		// A few hundred KB/s, way more than a kiosk writes
+		if (i % 500 == 499) {
+			usleep(20000);
+			if (uplink_stats.backlog > max_backlog) max_backlog = uplink_stats.backlog;
+		}
+	}
+}
+
+pid_t startServer(const char * drop) {
+	fflush(stdout);
+	pid_t pid = fork();
+	if (pid == 0) {
+		freopen("/tmp/uplinkbench-server.out", "w", stdout);
+		execl("./uplinkd", "uplinkd", PORT, SERVER_DIR, drop, (char *) NULL);
+		perror("./uplinkd");
+		_exit(1);
+	}
+	return pid;
+}
+
+// Returns the number of entries in the server's log, -1 if they aren't all there in order
+long checkServerLog(long expected) {
+	char path[300];
+	snprintf(path, sizeof(path), "%s/kiosk%d.log", SERVER_DIR, KIOSK);
+	FILE * f = fopen(path, "rb");
+	if (f == NULL) return -1;
+	uint64_t seq, last_seq = 0;
+	uint32_t len;
+	long cnt = 0, bad = 0;
+	while (fread(&seq, sizeof(seq), 1, f) == 1 && fread(&len, sizeof(len), 1, f) == 1) {
+		if (seq != last_seq + 1) bad++;
+		last_seq = seq;
+		unsigned char * raw = (unsigned char *) malloc(len);
+		if (fread(raw, 1, len, f) != len) bad++;
+		for (uint32_t p = 0; p + 5 <= len; ) {
+			uint32_t l;
+			memcpy(&l, raw + p + 1, 4);
+			struct Entry e;
+			memcpy(&e, raw + p + 5, sizeof(e));
+			if (raw[p] != UPLINK_ACCESS || l != sizeof(e) || e.n != cnt) bad++;
+			cnt++;
+			p += 5 + l;
+		}
+		free(raw);
+	}
+	fclose(f);
+	printf("server: %llu batches, %ld entries, %ld out of place\n", (unsigned long long) last_seq, cnt, bad);
+	return bad == 0 && cnt == expected ? cnt : -1;
+}
+
+int main(int argc, char * argv[]) {
+	long entries = argc > 1 ? atol(argv[1]) : 200000;
+	const char * drop = argc > 2 ? argv[2] : "0";
+
+	if (system("rm -rf " OUTBOX " " SERVER_DIR) != 0) return 1;
+	FILE * f = fopen(CONFIG, "w");
+	fprintf(f, "127.0.0.1 %s %d\n", PORT, KIOSK);
+	fclose(f);
+	if (uplinkInit(CONFIG, OUTBOX) != 0) return 1;
+
+	long t = monotonicUs();
+	putEntries(0, entries / 2);
+	sleep(1);
+	printf("server down: %ld batches in the outbox after %.1f s\n", uplink_stats.backlog, (monotonicUs() - t) / 1e6);
+
+	pid_t server = startServer(drop);
+	long t_up = monotonicUs();
+	putEntries(entries / 2, entries);
+	long t_put = monotonicUs();
+	uplinkClose();
+
+	// Everything is sealed now, send the rest like the next start would
+	uplinkInit(CONFIG, OUTBOX);
+	while (uplink_stats.backlog > 0 && monotonicUs() - t_put < 120 * 1000000L) usleep(10000);
+	long t_done = monotonicUs();
+	struct UplinkStats s = uplink_stats;
+	uplinkClose();
+	kill(server, SIGTERM);
+	waitpid(server, NULL, 0);
+
+	printf("%ld entries, %.1f KB raw in %.1f s, outbox empty %.2f s after the last put, "
+		"%.2f s after the server came up\n", entries, entries * sizeof(struct Entry) / 1024.0,
+		(t_put - t) / 1e6, (t_done - t_put) / 1e6, (t_done - t_up) / 1e6);
+	printf("at most %ld batches waiting, last ack after %ld us, worst %ld us, %ld entries dropped\n",
+		max_backlog, s.last_ack_us, s.max_ack_us, s.dropped);
+	uplinkPrintStats(stdout);
+	if (system("cat /tmp/uplinkbench-server.out") != 0) return 1;
+
+	if (checkServerLog(entries) < 0) {
+		printf("FAILED\n");
+		return 1;
+	}
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,169 @@
+/*
+	Stand-in for the log server, to test uplink.c without the real one.
+	Batches of kiosk K are checked, unpacked and appended to <dir>/kiosk<K>.log as
+	"<u64 seq> <u32 length> <entries>". <dir>/kiosk<K>.acked has the last stored seq.
+
+	./uplinkd [port] [dir] [drop every]
+
+	'drop every' N > 0 closes the connection after every N batches without acking the last
+	ones, so the client has to resume.
+*/
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "status.h"
+#include "uplink.h"
+
+char dir[256] = "/tmp/uplinkd";
+int drop_every = 0;
+
+static int readFull(int fd, void * buf, size_t len) {
+	char * p = (char *) buf;
+	while (len > 0) {
+		ssize_t n = recv(fd, p, len, 0);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return -1;
+		p += n;
+		len -= n;
+	}
+	return 0;
+}
+
+static uint64_t loadAcked(uint32_t kiosk) {
+	char path[300];
+	snprintf(path, sizeof(path), "%s/kiosk%u.acked", dir, kiosk);
+	unsigned long long seq = 0;
+	FILE * f = fopen(path, "r");
+	if (f) {
+		if (fscanf(f, "%llu", &seq) != 1) seq = 0;
+		fclose(f);
+	}
+	return seq;
+}
+
+static void saveAcked(uint32_t kiosk, uint64_t seq) {
+	char path[300], tmp[310];
+	snprintf(path, sizeof(path), "%s/kiosk%u.acked", dir, kiosk);
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	FILE * f = fopen(tmp, "w");
+	if (f == NULL) return;
+	fprintf(f, "%llu\n", (unsigned long long) seq);
+	fflush(f);
+	fsync(fileno(f));
+	fclose(f);
+	rename(tmp, path);
+}
+
+static void sendAck(int fd, uint64_t seq) {
+	struct UplinkAck ack = { UPLINK_MAGIC, 0, seq };
+	send(fd, &ack, sizeof(ack), MSG_NOSIGNAL);
+}
+
+static void serve(int fd) {
+	struct UplinkHello hello;
+	if (readFull(fd, &hello, sizeof(hello)) != 0 || hello.magic != UPLINK_MAGIC || hello.version != UPLINK_VERSION) {
+		fprintf(stderr, "bad hello\n");
+		return;
+	}
+	uint64_t acked = loadAcked(hello.kiosk);
+	sendAck(fd, acked);
+
+	char path[300];
+	snprintf(path, sizeof(path), "%s/kiosk%u.log", dir, hello.kiosk);
+	FILE * out = fopen(path, "ab");
+	if (out == NULL) {
+		perror(path);
+		return;
+	}
+
+	long start = monotonicUs(), frames = 0, dups = 0, bytes = 0, raw_bytes = 0;
+	struct UplinkFrame h;
+	unsigned char * buf = NULL, * raw = NULL;
+	while (readFull(fd, &h, sizeof(h)) == 0) {
+		if (h.magic != UPLINK_MAGIC || h.len > 16 * UPLINK_BATCH_MAX || h.raw_len > 16 * UPLINK_BATCH_MAX) {
+			fprintf(stderr, "bad frame\n");
+			break;
+		}
+		buf = (unsigned char *) realloc(buf, h.len);
+		raw = (unsigned char *) realloc(raw, h.raw_len + 1);
+		if (readFull(fd, buf, h.len) != 0) break;
+		uLongf raw_len = h.raw_len;
+		if (crc32(0, buf, h.len) != h.crc || uncompress(raw, &raw_len, buf, h.len) != Z_OK || raw_len != h.raw_len) {
+			fprintf(stderr, "batch %llu is broken\n", (unsigned long long) h.seq);
+			break;
+		}
+		frames++;
+		bytes += h.len + sizeof(h);
+		// Lost on the way, as if the connection broke
+		if (drop_every > 0 && frames % drop_every == 0) break;
+		if (h.seq <= acked) {
+			dups++;
+		} else if (h.seq != acked + 1) {
+			fprintf(stderr, "batch %llu after %llu, batches are missing\n", (unsigned long long) h.seq,
+				(unsigned long long) acked);
+			break;
+		} else {
+			uint32_t len = h.raw_len;
+			fwrite(&h.seq, sizeof(h.seq), 1, out);
+			fwrite(&len, sizeof(len), 1, out);
+			fwrite(raw, len, 1, out);
+			raw_bytes += len;
+			acked = h.seq;
+		}
+
+		// Group commit: one fsync for everything that has arrived already
+		char c;
+		if (recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) <= 0) {
+			fflush(out);
+			fsync(fileno(out));
+			saveAcked(hello.kiosk, acked);
+			sendAck(fd, acked);
+		}
+	}
+	// What was stored is acked on the next connection
+	fflush(out);
+	fsync(fileno(out));
+	saveAcked(hello.kiosk, acked);
+	fclose(out);
+	free(buf);
+	free(raw);
+	double s = (monotonicUs() - start) / 1e6;
+	printf("kiosk %u: %ld batches (%ld again), %.1f KB/s sent, %.1f KB/s unpacked, acked up to %llu\n",
+		hello.kiosk, frames, dups, bytes / 1024.0 / s, raw_bytes / 1024.0 / s, (unsigned long long) loadAcked(hello.kiosk));
+	fflush(stdout);
+}
+
+int main(int argc, char * argv[]) {
+	int port = argc > 1 ? atoi(argv[1]) : 7070;
+	if (argc > 2) snprintf(dir, sizeof(dir), "%s", argv[2]);
+	if (argc > 3) drop_every = atoi(argv[3]);
+	mkdir(dir, 0755);
+
+	int s = socket(AF_INET, SOCK_STREAM, 0);
+	int one = 1;
+	setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+	if (bind(s, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(s, 4) != 0) {
+		perror("uplinkd");
+		return 1;
+	}
+	printf("listening on %d, storing in %s\n", port, dir);
+	fflush(stdout);
+	while (1) {
+		int fd = accept(s, NULL, NULL);
+		if (fd < 0) continue;
+		serve(fd);
+		close(fd);
+	}
+}